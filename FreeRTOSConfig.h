@@ -0,0 +1,65 @@
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+// FreeRTOS settings for DIMMER_FREERTOS builds: SMP on both RP2040 cores,
+// tasks created from the table in main.c by tasks.c
+
+#include <assert.h>
+
+// Scheduler
+#define configUSE_PREEMPTION 1
+#define configUSE_TIME_SLICING 0 // Tasks of one priority run to completion against each other
+#define configUSE_TICKLESS_IDLE 0 // Not supported with two cores, idle cores wait in WFI between ticks
+#define configUSE_IDLE_HOOK 0
+#define configUSE_PASSIVE_IDLE_HOOK 0
+#define configUSE_TICK_HOOK 0
+#define configTICK_RATE_HZ 1000
+#define configMAX_PRIORITIES 8
+#define configMINIMAL_STACK_SIZE 256
+#define configMAX_TASK_NAME_LEN 16
+#define configUSE_16_BIT_TICKS 0
+#define configIDLE_SHOULD_YIELD 1
+#define configUSE_TASK_NOTIFICATIONS 1
+
+// SMP
+#define configNUMBER_OF_CORES 2
+#define configNUM_CORES configNUMBER_OF_CORES // Name used by older kernels
+#define configTICK_CORE 0
+#define configRUN_MULTIPLE_PRIORITIES 1
+#define configUSE_CORE_AFFINITY 1
+
+// RP2040 port: SDK locks and sleeps cooperate with the scheduler
+#define configSUPPORT_PICO_SYNC_INTEROP 1
+#define configSUPPORT_PICO_TIME_INTEROP 1
+
+// Synchronization
+#define configUSE_MUTEXES 1
+#define configUSE_RECURSIVE_MUTEXES 1
+#define configUSE_COUNTING_SEMAPHORES 1
+#define configQUEUE_REGISTRY_SIZE 0
+
+// Memory
+#define configSUPPORT_STATIC_ALLOCATION 0
+#define configSUPPORT_DYNAMIC_ALLOCATION 1
+#define configTOTAL_HEAP_SIZE (24 * 1024) // Task stacks and control blocks, heap_4
+#define configAPPLICATION_ALLOCATED_HEAP 0
+#define configUSE_MALLOC_FAILED_HOOK 0
+#define configCHECK_FOR_STACK_OVERFLOW 0
+
+// Software timers, the SDK interop needs the daemon task
+#define configUSE_TIMERS 1
+#define configTIMER_TASK_PRIORITY (configMAX_PRIORITIES - 1)
+#define configTIMER_QUEUE_LENGTH 10
+#define configTIMER_TASK_STACK_DEPTH configMINIMAL_STACK_SIZE
+
+#define configASSERT(x) assert(x)
+
+// API functions linked in
+#define INCLUDE_vTaskDelay 1
+#define INCLUDE_xTaskDelayUntil 1
+#define INCLUDE_vTaskDelayUntil 1
+#define INCLUDE_xTaskGetCurrentTaskHandle 1
+#define INCLUDE_xTaskGetIdleTaskHandle 1
+#define INCLUDE_vTaskSuspend 1
+
+#endif
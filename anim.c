@@ -0,0 +1,101 @@
+#include "anim.h"
+
+#define SEGMENTS (1 << ANIM_CURVE_BITS)
+#define FRAC_BITS (16 - ANIM_CURVE_BITS) // Progress bits between two table entries
+
+// Easing tables, SEGMENTS + 1 samples of the curve at x = i / SEGMENTS scaled to 0..65535
+#define X(i) ((double)(i) / SEGMENTS)
+#define SAMPLE(y) ((uint16_t)((y) * 65535.0 + 0.5))
+#define EASE_IN(i) SAMPLE(X(i) * X(i)),
+#define EASE_OUT(i) SAMPLE(1.0 - (1.0 - X(i)) * (1.0 - X(i))),
+#define EASE_IN_OUT(i) SAMPLE(X(i) * X(i) * (3.0 - 2.0 * X(i))),
+// (2^(8x) - 1) / 255 with 2^(i/8) split into a shift and one of eight fractional powers
+#define EXP2_8TH(j) ((j) == 0 ? 1.0 : (j) == 1 ? 1.0905077327 : (j) == 2 ? 1.1892071150 : (j) == 3 ? 1.2968395547 : \
+                     (j) == 4 ? 1.4142135624 : (j) == 5 ? 1.5422108254 : (j) == 6 ? 1.6817928305 : 1.8340080864)
+#define EXP(i) SAMPLE(((double)(1u << ((i) >> 3)) * EXP2_8TH((i) & 7) - 1.0) / 255.0),
+
+_Static_assert(SEGMENTS == 64, "TABLE65() expands 64 segments");
+
+static const uint16_t curves[ANIM_CURVES][SEGMENTS + 1] = {
+    [ANIM_EASE_IN] = TABLE65(EASE_IN),
+    [ANIM_EASE_OUT] = TABLE65(EASE_OUT),
+    [ANIM_EASE_IN_OUT] = TABLE65(EASE_IN_OUT),
+    [ANIM_EXP] = TABLE65(EXP)
+};
+
+void anim_init(anim_t *a) {
+    for (uint32_t c = 0; c < ANIM_CHANNELS; c++) a->value[c] = 0;
+    a->n_active = 0;
+}
+
+// Position of channel in the active list, n_active if it isn't there
+static uint32_t find_active(const anim_t *a, const uint32_t channel) {
+    uint32_t i = 0;
+    while (i < a->n_active && a->active[i] != channel) i++;
+    return i;
+}
+
+static void stop(anim_t *a, const uint32_t i) {
+    // Order of the active list doesn't matter, fill the hole with the last entry
+    a->active[i] = a->active[--a->n_active];
+}
+
+void anim_set(anim_t *a, const uint32_t channel, const q16_t value) {
+    if (channel >= ANIM_CHANNELS) return;
+    a->value[channel] = value;
+    const uint32_t i = find_active(a, channel);
+    if (i < a->n_active) stop(a, i);
+}
+
+void anim_start(anim_t *a, const uint32_t channel, const q16_t to, const uint32_t ms, const anim_curve curve,
+                const uint32_t now_ms) {
+    if (channel >= ANIM_CHANNELS) return;
+    if (ms == 0 || a->value[channel] == to) {
+        anim_set(a, channel, to);
+        return;
+    }
+
+    // A new target takes over from the current value, so a transition can be redirected without a jump
+    a->transition[channel] = (anim_transition_t){
+        .from = a->value[channel], .to = to, .start_ms = now_ms, .ms = ms, .curve = curve < ANIM_CURVES ? curve : ANIM_LINEAR
+    };
+    if (find_active(a, channel) == a->n_active) a->active[a->n_active++] = (uint8_t)channel;
+}
+
+// Curve value at progress p, both 0..65535
+static uint32_t ease(const anim_curve curve, const uint32_t p) {
+    if (curve == ANIM_LINEAR) return p;
+    const uint16_t *t = curves[curve];
+    const uint32_t i = p >> FRAC_BITS;
+    const uint32_t frac = p & ((1u << FRAC_BITS) - 1);
+    // Tables only rise, so the difference is never negative
+    return t[i] + ((uint32_t)(t[i + 1] - t[i]) * frac >> FRAC_BITS);
+}
+
+bool anim_tick(anim_t *a, const uint32_t now_ms) {
+    bool changed = false;
+    uint32_t i = 0;
+    while (i < a->n_active) {
+        const uint32_t c = a->active[i];
+        const anim_transition_t *t = &a->transition[c];
+        const uint32_t elapsed = now_ms - t->start_ms;
+        const q16_t before = a->value[c];
+
+        if (elapsed >= t->ms) {
+            a->value[c] = t->to;
+            stop(a, i); // The entry moved into slot i is visited next
+        }
+        else {
+            const uint32_t p = (uint32_t)(((uint64_t)elapsed << 16) / t->ms);
+            const int64_t span = (int64_t)t->to - (int64_t)t->from;
+            a->value[c] = (q16_t)((int64_t)t->from + (span * ease(t->curve, p) >> 16));
+            i++;
+        }
+        if (a->value[c] != before) changed = true;
+    }
+    return changed;
+}
+
+bool anim_busy(const anim_t *a) {
+    return a->n_active > 0;
+}
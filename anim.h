@@ -0,0 +1,47 @@
+#ifndef ANIM_H
+#define ANIM_H
+
+// Animation engine for brightness transitions. Each channel holds a Q16
+// value and runs at most one transition towards a target along an easing
+// curve. anim_tick() only visits channels with a running transition, so
+// idle channels cost nothing. Callers pass the time in, the engine never reads a clock.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "fixed.h"
+
+#define ANIM_CHANNELS 4 // Independently animated values
+#define ANIM_CURVE_BITS 6 // Easing tables have 2^ANIM_CURVE_BITS segments
+
+// Shape of a transition over its duration
+typedef enum {
+    ANIM_LINEAR,
+    ANIM_EASE_IN, // Starts slow, quadratic
+    ANIM_EASE_OUT, // Ends slow, quadratic
+    ANIM_EASE_IN_OUT, // Smoothstep
+    ANIM_EXP, // Exponential, even steps for the eye when brightening
+    ANIM_CURVES
+} anim_curve;
+
+typedef struct {
+    q16_t from;
+    q16_t to;
+    uint32_t start_ms;
+    uint32_t ms; // Duration
+    anim_curve curve;
+} anim_transition_t;
+
+typedef struct {
+    q16_t value[ANIM_CHANNELS]; // Current value of each channel
+    anim_transition_t transition[ANIM_CHANNELS];
+    uint8_t active[ANIM_CHANNELS]; // Channels with a running transition, first n_active are valid
+    uint8_t n_active;
+} anim_t;
+
+void anim_init(anim_t *a); // All channels at 0 and idle
+void anim_set(anim_t *a, uint32_t channel, q16_t value); // Jump to value, ends a running transition
+void anim_start(anim_t *a, uint32_t channel, q16_t to, uint32_t ms, anim_curve curve, uint32_t now_ms); // From the current value
+bool anim_tick(anim_t *a, uint32_t now_ms); // Advance running transitions, returns true if any value changed
+bool anim_busy(const anim_t *a); // A transition is running
+
+#endif
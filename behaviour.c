@@ -0,0 +1,30 @@
+#include "behaviour.h"
+#include "board.h"
+#include "coro.h"
+#include "persist.h"
+#include "hardware/gpio.h"
+
+// Frame of the long press behaviour, the coroutine's locals
+typedef struct {
+    coro_t coro;
+    const anim_t *anim;
+} long_press_t;
+
+static long_press_t long_press;
+
+static bool long_press_save(coro_t *c) {
+    long_press_t *f = (long_press_t *)c;
+    CORO_BEGIN(c);
+    // ROT_SW reads high once released
+    CORO_DEADLINE(c, RELEASE_TIMEOUT_MS);
+    CORO_WAIT(c, CORO_BUTTON | CORO_TIMER, gpio_get(ROT_SW) || CORO_EXPIRED(c));
+    CORO_WAIT(c, CORO_TICK, !anim_busy(f->anim));
+    persist_flush();
+    CORO_END(c);
+}
+
+void behaviour_long_press(const anim_t *anim, const uint32_t now_ms) {
+    // A long press while the last one is still saving is covered by that one
+    long_press.anim = anim;
+    coro_start(&long_press.coro, long_press_save, now_ms);
+}
@@ -0,0 +1,16 @@
+#ifndef BEHAVIOUR_H
+#define BEHAVIOUR_H
+
+// Multi-step behaviours written as coroutines (coro.h), started by the main
+// loop from the events that begin them
+
+#include "pico/stdlib.h"
+#include "anim.h"
+
+#define RELEASE_TIMEOUT_MS 5000 // Longest wait for the button to be let go
+
+// After a long press: wait for the release, wait for the output fade to land,
+// then write the state to flash right away instead of after PERSIST_DELAY_MS
+void behaviour_long_press(const anim_t *anim, uint32_t now_ms);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+// Pin layout of the dimmer board. Slices, channels and pin masks are derived
+// at compile time, so LED updates fold into fixed register writes and a
+// layout with clashing pins or PWM channels doesn't build.
+
+#include "pico/stdlib.h"
+
+#define ROT_A 10 // Rotary encoder input without pull-up/pull-down
+#define ROT_B 11 // Rotary encoder input without pull-up/pull-down
+#define ROT_SW 12 // Rotary encoder input with pull-up
+
+#define LED_R 22 // right LED pin
+#define LED_M 21 // middle LED pin
+#define LED_L 20 // left LED pin
+#define LEDS_SIZE 3 // number of LEDs
+
+#define AMBIENT_PIN 26 // ADC0, photodiode for DIMMER_AMBIENT
+#define AMBIENT_INPUT (AMBIENT_PIN - 26) // ADC input of AMBIENT_PIN
+
+#define STRIP_PIN 15 // WS2812 data for DIMMER_STRIP, driven by PIO
+
+#define SYNC_TX_PIN 4 // uart1 TX, leader output on the sync bus
+#define SYNC_RX_PIN 5 // uart1 RX, follower input on the sync bus
+
+#define BOARD_GPIOS 30 // GPIOs in user bank 0
+#define PWM_SLICES 8 // PWM slices on RP2040
+
+#define FX_PACE_SLICE 7 // PWM slice without pins, its wrap paces effect playback
+
+#define PIN_BIT(pin) (1u << (pin))
+#define PWM_SLICE(pin) (((pin) >> 1) & 7u) // Same mapping as pwm_gpio_to_slice_num()
+#define PWM_CHAN(pin) ((pin) & 1u) // Same mapping as pwm_gpio_to_channel()
+#define PWM_CHAN_BIT(pin) (1u << (PWM_SLICE(pin) * 2 + PWM_CHAN(pin))) // Channel A and B of each slice
+
+#define LED_PINS (PIN_BIT(LED_R) | PIN_BIT(LED_M) | PIN_BIT(LED_L))
+#define LED_CHANNELS (PWM_CHAN_BIT(LED_R) | PWM_CHAN_BIT(LED_M) | PWM_CHAN_BIT(LED_L))
+#define LED_SLICES (PIN_BIT(PWM_SLICE(LED_R)) | PIN_BIT(PWM_SLICE(LED_M)) | PIN_BIT(PWM_SLICE(LED_L)))
+#define ROT_PINS (PIN_BIT(ROT_A) | PIN_BIT(ROT_B) | PIN_BIT(ROT_SW))
+#define UART_PINS (PIN_BIT(PICO_DEFAULT_UART_TX_PIN) | PIN_BIT(PICO_DEFAULT_UART_RX_PIN) | \
+                   PIN_BIT(SYNC_TX_PIN) | PIN_BIT(SYNC_RX_PIN))
+
+_Static_assert(LED_R < BOARD_GPIOS && LED_M < BOARD_GPIOS && LED_L < BOARD_GPIOS, "LED pin out of range");
+_Static_assert(ROT_A < BOARD_GPIOS && ROT_B < BOARD_GPIOS && ROT_SW < BOARD_GPIOS, "encoder pin out of range");
+_Static_assert(PWM_CHAN_BIT(LED_R) != PWM_CHAN_BIT(LED_M) && PWM_CHAN_BIT(LED_R) != PWM_CHAN_BIT(LED_L) &&
+               PWM_CHAN_BIT(LED_M) != PWM_CHAN_BIT(LED_L), "two LEDs share a PWM channel");
+_Static_assert(AMBIENT_PIN >= 26 && AMBIENT_PIN <= 29, "ambient sensor must be on an ADC pin");
+_Static_assert((LED_SLICES & PIN_BIT(FX_PACE_SLICE)) == 0, "effect pacing slice drives an LED");
+_Static_assert(ROT_A != ROT_B && ROT_A != ROT_SW && ROT_B != ROT_SW, "encoder pins must be distinct");
+_Static_assert((LED_PINS & ROT_PINS) == 0, "LED and encoder pins overlap");
+_Static_assert(((LED_PINS | ROT_PINS | UART_PINS) & PIN_BIT(AMBIENT_PIN)) == 0, "ambient sensor pin is already used");
+_Static_assert(((LED_PINS | ROT_PINS) & UART_PINS) == 0, "LED or encoder pin is used by a UART");
+_Static_assert(((LED_PINS | ROT_PINS | UART_PINS | PIN_BIT(AMBIENT_PIN)) & PIN_BIT(STRIP_PIN)) == 0,
+               "strip data pin is already used");
+
+#endif
@@ -0,0 +1,23 @@
+#include "cct.h"
+
+// Emitter weights in Q16 (65535 is full) for each step. Warm fades out over the
+// first half while neutral fades in, cool takes over from neutral in the second
+// half. Weights of a step add up to one, so the total output stays at the
+// requested level while the colour changes.
+#define X(i) ((double)(i) / CCT_MAX)
+#define WEIGHT(w) ((uint16_t)((w) * 65535.0 + 0.5))
+#define WARM(x) ((x) < 0.5 ? 1.0 - 2.0 * (x) : 0.0)
+#define COOL(x) ((x) > 0.5 ? 2.0 * (x) - 1.0 : 0.0)
+#define MIX(i) { WEIGHT(WARM(X(i))), WEIGHT(1.0 - WARM(X(i)) - COOL(X(i))), WEIGHT(COOL(X(i))) },
+
+_Static_assert(CCT_MAX == 64, "TABLE65() expands 65 steps");
+
+static const uint16_t mix[CCT_MAX + 1][CCT_EMITTERS] = TABLE65(MIX);
+
+void cct_mix(const uint32_t level, const uint32_t cct, q16_t levels[CCT_EMITTERS]) {
+    const uint16_t *w = mix[cct > CCT_MAX ? CCT_MAX : cct];
+    // Integer level times Q16 weight is the Q16 result; level is at most MAX_BR, far below 2^16
+    levels[CCT_WARM] = level * w[CCT_WARM];
+    levels[CCT_NEUTRAL] = level * w[CCT_NEUTRAL];
+    levels[CCT_COOL] = level * w[CCT_COOL];
+}
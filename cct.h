@@ -0,0 +1,23 @@
+#ifndef CCT_H
+#define CCT_H
+
+// Tunable white. The three LED channels carry warm, neutral and cool
+// emitters; a colour temperature step selects a blend of them and the
+// intensity scales the blend. Integer arithmetic only, no hardware access.
+
+#include <stdint.h>
+#include "fixed.h"
+
+#define CCT_MAX 64 // Colour temperature steps from warm (0) to cool (CCT_MAX)
+#define CCT_MID (CCT_MAX / 2) // Neutral emitter alone
+#define CCT_RATE 2 // Steps per press-and-turn detent
+
+// Emitter on each LED channel, as index into the levels given to the LEDs
+#define CCT_WARM 0 // LED_R
+#define CCT_NEUTRAL 1 // LED_M
+#define CCT_COOL 2 // LED_L
+#define CCT_EMITTERS 3
+
+void cct_mix(uint32_t level, uint32_t cct, q16_t levels[CCT_EMITTERS]); // Q16 compare value per emitter
+
+#endif
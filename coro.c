@@ -0,0 +1,75 @@
+#include "coro.h"
+#include "tasks.h"
+#include "hardware/sync.h"
+
+static coro_t *running[CORO_MAX];
+static uint running_count;
+static volatile uint waiting; // Sources some coroutine waits on
+static volatile uint pending; // Sources signalled since the last coro_run()
+
+static void update_waiting(void) {
+    uint sources = 0;
+    for (uint i = 0; i < running_count; i++) sources |= running[i]->waits;
+    // Deadlines are checked at control ticks
+    if (sources & CORO_TIMER) sources |= CORO_TICK;
+
+    // A signal that came in while the coroutines ran is kept if they wait on it now
+    const uint32_t ints = save_and_disable_interrupts();
+    waiting = sources;
+    pending &= sources;
+    const bool wake = pending != 0;
+    restore_interrupts(ints);
+    if (wake) tasks_signal();
+}
+
+static bool is_running(const coro_t *c) {
+    for (uint i = 0; i < running_count; i++) {
+        if (running[i] == c) return true;
+    }
+    return false;
+}
+
+bool coro_start(coro_t *c, bool (*resume)(coro_t *c), const uint32_t now_ms) {
+    if (running_count == CORO_MAX || is_running(c)) return false;
+    *c = (coro_t){ .resume = resume, .now_ms = now_ms };
+    if (resume(c)) running[running_count++] = c;
+    update_waiting();
+    return true;
+}
+
+void coro_signal(const uint sources) {
+    const uint32_t ints = save_and_disable_interrupts();
+    pending |= sources;
+    restore_interrupts(ints);
+    if (sources & waiting) tasks_signal();
+}
+
+bool coro_pending(void) {
+    return (pending & waiting) != 0;
+}
+
+void coro_run(const uint32_t now_ms) {
+    const uint32_t ints = save_and_disable_interrupts();
+    const uint fired = pending;
+    pending = 0;
+    restore_interrupts(ints);
+
+    for (uint i = 0; i < running_count;) {
+        coro_t *c = running[i];
+        uint woken = fired & c->waits;
+        if ((c->waits & CORO_TIMER) && (fired & CORO_TICK) && (int32_t)(now_ms - c->deadline_ms) >= 0) woken |= CORO_TIMER;
+        if (!woken) {
+            i++;
+            continue;
+        }
+        c->woken = (uint8_t)woken;
+        c->now_ms = now_ms;
+        if (c->resume(c)) {
+            i++;
+            continue;
+        }
+        // Finished, the last one takes its place
+        running[i] = running[--running_count];
+    }
+    update_waiting();
+}
@@ -0,0 +1,57 @@
+#ifndef CORO_H
+#define CORO_H
+
+// Stackless coroutines for multi-step behaviours. A behaviour is a function
+// whose locals live in a static frame that starts with a coro_t; the CORO_
+// macros turn it into a switch on the line it last waited at, so it reads top
+// to bottom and resumes there without a stack or a thread of its own.
+// Waits name the sources that can end them, and a coroutine is only resumed
+// when one of those was signalled:
+//   CORO_BUTTON  ROT_SW edge, signalled by the GPIO callback
+//   CORO_TICK    control tick, signalled by the control task
+//   CORO_TIMER   deadline from CORO_DEADLINE passed, checked at control ticks
+// Locals that must survive a wait belong in the frame, not on the stack, and
+// CORO_ macros can't be used inside a switch of the behaviour's own.
+
+#include "pico/stdlib.h"
+
+#define CORO_MAX 4 // Coroutines running at once
+
+#define CORO_BUTTON 0x01u
+#define CORO_TICK 0x02u
+#define CORO_TIMER 0x04u
+
+typedef struct coro coro_t;
+struct coro {
+    bool (*resume)(coro_t *c); // Behaviour, returns false once it has finished
+    uint16_t line; // Where to resume, 0 before the first run
+    uint8_t waits; // Sources the current wait ends on
+    uint8_t woken; // Sources that resumed it this time
+    uint32_t now_ms; // Time of this resume
+    uint32_t deadline_ms; // CORO_TIMER
+};
+
+#define CORO_BEGIN(c) switch ((c)->line) { case 0:
+#define CORO_END(c) } (c)->line = 0; return false
+
+// Return to the caller until cond holds, checked again whenever one of sources is signalled
+#define CORO_WAIT(c, sources, cond) \
+    do { \
+        (c)->waits = (sources); \
+        (c)->woken = 0; \
+        (c)->line = __LINE__; case __LINE__: \
+        if (!(cond)) return true; \
+        (c)->waits = 0; \
+    } while (0)
+
+#define CORO_DEADLINE(c, ms) ((c)->deadline_ms = (c)->now_ms + (ms)) // Arm CORO_TIMER, ms from now
+#define CORO_EXPIRED(c) ((int32_t)((c)->now_ms - (c)->deadline_ms) >= 0)
+#define CORO_NEXT_TICK(c) CORO_WAIT(c, CORO_TICK, (c)->woken & CORO_TICK)
+#define CORO_SLEEP_MS(c, ms) do { CORO_DEADLINE(c, ms); CORO_WAIT(c, CORO_TIMER, CORO_EXPIRED(c)); } while (0)
+
+bool coro_start(coro_t *c, bool (*resume)(coro_t *c), uint32_t now_ms); // Run to the first wait, false if c is running or there is no room
+void coro_signal(uint sources); // Any context
+bool coro_pending(void); // A signal is waiting for coro_run()
+void coro_run(uint32_t now_ms); // Resume the coroutines their signals woke, main loop only
+
+#endif
@@ -0,0 +1,36 @@
+#include "derate.h"
+
+void derate_init(derate_t *dr) {
+    dr->factor = Q16(1);
+    dr->temp_mc = 0;
+    dr->peak_mc = INT32_MIN;
+    dr->entries = 0;
+}
+
+// Factor for a temperature without hysteresis
+static q16_t curve(const int32_t temp_mc) {
+    if (temp_mc <= DERATE_START_MC) return Q16(1);
+    if (temp_mc >= DERATE_FULL_MC) return DERATE_MIN;
+    // At most Q16(1) times the 15 degree range, the product stays below 2^31
+    const int32_t span = (int32_t)(Q16(1) - DERATE_MIN);
+    return Q16(1) - (q16_t)(span * (temp_mc - DERATE_START_MC) / (DERATE_FULL_MC - DERATE_START_MC));
+}
+
+q16_t derate_update(derate_t *dr, const int32_t temp_mc) {
+    const bool was_active = derate_active(dr);
+    dr->temp_mc = temp_mc;
+    if (temp_mc > dr->peak_mc) dr->peak_mc = temp_mc;
+
+    // Down right away, up only with DERATE_HYST_MC of margin
+    const q16_t hot = curve(temp_mc);
+    const q16_t cooled = curve(temp_mc + DERATE_HYST_MC);
+    if (hot < dr->factor) dr->factor = hot;
+    else if (cooled > dr->factor) dr->factor = cooled;
+
+    if (!was_active && derate_active(dr)) dr->entries++;
+    return dr->factor;
+}
+
+bool derate_active(const derate_t *dr) {
+    return dr->factor < Q16(1);
+}
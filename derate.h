@@ -0,0 +1,33 @@
+#ifndef DERATE_H
+#define DERATE_H
+
+// Thermal derating. Above DERATE_START_MC the output factor falls linearly to
+// DERATE_MIN at DERATE_FULL_MC. The factor follows a rising temperature at
+// once but only recovers once the die is DERATE_HYST_MC cooler than the
+// temperature that set it, so the output doesn't hunt around a threshold.
+// derate_update() takes the temperature as an argument, so recorded or made-up
+// temperature profiles can be replayed on the host.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "fixed.h"
+
+#define DERATE_START_MC 70000 // Die temperature where derating starts, milli-degrees C
+#define DERATE_FULL_MC 85000 // Temperature with the factor at DERATE_MIN
+#define DERATE_MIN (Q16(1) / 4) // Lowest output factor
+#define DERATE_HYST_MC 5000 // Cooling needed before the factor recovers
+_Static_assert((int64_t)Q16(1) * (DERATE_FULL_MC - DERATE_START_MC) < INT32_MAX, "derate slope overflows");
+
+// Derating state, also the derate stats
+typedef struct {
+    q16_t factor; // Applied to every LED channel, Q16(1) = no derating
+    int32_t temp_mc; // Latest temperature
+    int32_t peak_mc; // Highest temperature seen
+    uint32_t entries; // Times derating started
+} derate_t;
+
+void derate_init(derate_t *dr); // Factor 1, nothing seen yet
+q16_t derate_update(derate_t *dr, int32_t temp_mc); // New temperature, returns the factor
+bool derate_active(const derate_t *dr);
+
+#endif
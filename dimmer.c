@@ -0,0 +1,158 @@
+#include <assert.h>
+#include "dimmer.h"
+
+// Brightness change for a signed step count. Steps beyond MAX_BR can't move
+// the level any further, capping them keeps a corrupted count from overflowing.
+static int32_t step_delta(const int32_t steps, const int32_t rate) {
+    const int32_t capped = steps > (int32_t)MAX_BR ? (int32_t)MAX_BR : steps < -(int32_t)MAX_BR ? -(int32_t)MAX_BR : steps;
+    return capped * rate;
+}
+
+void dimmer_init(dimmer_t *d) {
+    d->brightness = BR_MID;
+    d->lights_on = false;
+    d->press_handled = false;
+    d->cct = CCT_MID;
+    d->effect = 0;
+    d->cap = MAX_BR;
+    d->transition_ms = 0;
+    d->transition_curve = ANIM_LINEAR;
+}
+
+static void transition(dimmer_t *d, const uint32_t ms, const anim_curve curve) {
+    d->transition_ms = ms;
+    d->transition_curve = curve;
+}
+
+bool dimmer_handle_event(dimmer_t *d, const event_t *event) {
+    const uint32_t before = dimmer_level(d);
+    const uint32_t cct_before = d->cct;
+    const uint32_t effect_before = d->effect;
+
+    // Level changes are instant unless the event asks for a transition
+    transition(d, 0, ANIM_LINEAR);
+
+    // A press switches the lights on, or restores 50% if they are on at 0%,
+    // right away. Switching off waits for the click so a press that turns
+    // into a gesture leaves the lights on.
+    if (event->type == EVENT_BUTTON && event->data == 1) {
+        d->press_handled = !d->lights_on || d->brightness == 0;
+        if (d->lights_on && d->brightness == 0) {
+            d->brightness = BR_MID;
+        }
+        d->lights_on = true;
+        transition(d, SWITCH_MS, ANIM_EASE_IN_OUT);
+    }
+
+    // Short press released without a gesture turns the lights off, unless its press already acted
+    if (event->type == EVENT_CLICK) {
+        if (!d->press_handled) {
+            d->lights_on = false;
+            transition(d, SWITCH_MS, ANIM_EASE_IN_OUT);
+        }
+        d->press_handled = false;
+    }
+
+    // Gestures always leave the lights on
+    if (event->type == EVENT_LONG_PRESS) {
+        d->brightness = MAX_BR;
+        d->lights_on = true;
+        transition(d, GESTURE_MS, ANIM_EXP);
+    }
+    if (event->type == EVENT_DOUBLE_CLICK) {
+        d->brightness = BR_PRESET;
+        d->lights_on = true;
+        transition(d, GESTURE_MS, ANIM_EXP);
+    }
+    if (event->type == EVENT_TRIPLE_CLICK) {
+        d->effect = (d->effect + 1) % EFFECTS;
+        d->lights_on = true;
+    }
+    if (event->type == EVENT_PRESS_TURN && d->lights_on) {
+        // Tunable white fixtures turn colour, others fine tune the brightness
+        if (DIMMER_CCT) {
+            const int32_t cct = (int32_t)d->cct + step_delta(event->data, CCT_RATE);
+            d->cct = cct < 0 ? 0 : cct > CCT_MAX ? CCT_MAX : (uint32_t)cct;
+        }
+        else {
+            d->brightness = clamp((int32_t)d->brightness + step_delta(event->data, BR_FINE_RATE));
+        }
+        transition(d, STEP_MS, ANIM_EASE_OUT);
+    }
+
+    // Handle encoder rotation events only when lights are on
+    if (event->type == EVENT_ENCODER && d->lights_on) {
+        // Update brightness according to rotation direction and clamp to valid range.
+        // One event is usually one step; the queue merges steps when it overflows.
+        d->brightness = clamp((int32_t)d->brightness + step_delta(event->data, BR_RATE));
+        transition(d, STEP_MS, ANIM_EASE_OUT);
+    }
+
+    // Remote commands switch the lights on directly
+    if (event->type == EVENT_SET_LEVEL) {
+        d->brightness = clamp(event->data);
+        d->lights_on = true;
+    }
+    if (event->type == EVENT_SET_POWER) {
+        d->lights_on = event->data != 0;
+    }
+    if (event->type == EVENT_SYNC) {
+        const uint32_t data = (uint32_t)event->data;
+        d->brightness = clamp((int32_t)(data & ((1u << FADE_LEVEL_BITS) - 1)));
+        d->lights_on = (data >> FADE_LEVEL_BITS) & 1;
+        // Finish the leader's transition along its curve, so both outputs move in step
+        const uint32_t fade = data >> SYNC_FADE_SHIFT;
+        const uint32_t curve = (data >> SYNC_CURVE_SHIFT) & 7;
+        transition(d, fade & 0x10000 ? (fade & 0xFFFF) << 5 : fade,
+                   curve < ANIM_CURVES ? (anim_curve)curve : ANIM_LINEAR);
+    }
+    // The state takes the target at once, the output gets there over the fade
+    if (event->type == EVENT_FADE) {
+        d->brightness = clamp((int32_t)((uint32_t)event->data & ((1u << FADE_LEVEL_BITS) - 1)));
+        d->lights_on = true;
+        transition(d, (uint32_t)event->data >> FADE_LEVEL_BITS, ANIM_LINEAR);
+    }
+
+    if (event->type == EVENT_NIGHT_CAP) {
+        d->cap = clamp(event->data);
+        transition(d, SWITCH_MS, ANIM_EASE_IN_OUT);
+    }
+    // Nothing goes above the cap, whichever event set the brightness
+    if (d->brightness > d->cap) d->brightness = d->cap;
+
+    // Switching off ends an effect, the lights come back steady
+    if (!d->lights_on) d->effect = 0;
+
+    assert(dimmer_invariants_hold(d));
+    return dimmer_level(d) != before || d->cct != cct_before || d->effect != effect_before;
+}
+
+uint32_t dimmer_level(const dimmer_t *d) {
+    return d->lights_on ? d->brightness : 0;
+}
+
+bool dimmer_invariants_hold(const dimmer_t *d) {
+    // Compare value must stay within [0, MAX_BR]; MAX_BR is 100% duty
+    if (d->brightness > MAX_BR) return false;
+    // Night mode holds the brightness down
+    if (d->cap > MAX_BR || d->brightness > d->cap) return false;
+    // Lights off always means zero duty
+    if (!d->lights_on && dimmer_level(d) != 0) return false;
+    // Lights on always drives the stored brightness
+    if (d->lights_on && dimmer_level(d) != d->brightness) return false;
+    // Effects only play while the lights are on
+    if (d->effect >= EFFECTS || (!d->lights_on && d->effect != 0)) return false;
+    // Colour stays between the warm and cool ends
+    if (d->cct > CCT_MAX) return false;
+    // Transitions have a known shape
+    if (d->transition_curve >= ANIM_CURVES) return false;
+    return true;
+}
+
+uint32_t clamp(const int32_t br) {
+    // Limit brightness value to valid PWM compare range [0, MAX_BR].
+    // MAX_BR is TOP + 1, which holds the output high for the whole period (100% duty).
+    if (br < 0) return 0; // Lower bound
+    if (br > MAX_BR) return MAX_BR; // Upper bound
+    return (uint32_t)br; // Within range
+}
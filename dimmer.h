@@ -0,0 +1,90 @@
+#ifndef DIMMER_H
+#define DIMMER_H
+
+// Dimmer state machine. Kept free of Pico SDK dependencies so the same logic
+// can be compiled for the host and driven with arbitrary event sequences.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "anim.h"
+#include "cct.h"
+
+#ifndef DIMMER_CCT
+#define DIMMER_CCT 0 // Set by the DIMMER_CCT CMake option: press-and-turn tunes colour temperature
+#endif
+
+#define TOP 999 // PWM counter top value
+
+#define BR_RATE 50 // step size for brightness change
+#define MAX_BR (TOP + 1) // max brightness, compare value TOP + 1 keeps the output high for the whole period
+#define BR_MID (MAX_BR / 2) // 50% brightness level
+#define BR_PRESET (MAX_BR * 3 / 10) // Level a double click goes to
+#define BR_FINE_RATE 5 // step size for press-and-turn fine adjustment
+#define EFFECTS 4 // Lighting effects a triple click cycles through, 0 is steady light
+
+// How the output moves to a new level
+#define STEP_MS 80 // Encoder steps, short enough to keep up with the knob
+#define SWITCH_MS 200 // On/off
+#define GESTURE_MS 400 // Long press and double click presets
+
+#define FADE_LEVEL_BITS 11 // Bits of EVENT_FADE data holding the target level
+#define FADE_MAX_MS ((1u << (32 - FADE_LEVEL_BITS)) - 1) // Longest fade EVENT_FADE data can carry
+#define FADE_DATA(level, ms) ((int32_t)(((uint32_t)(ms) << FADE_LEVEL_BITS) | (uint32_t)(level))) // Pack EVENT_FADE data
+_Static_assert(MAX_BR < (1 << FADE_LEVEL_BITS), "fade target level doesn't fit FADE_LEVEL_BITS");
+// EVENT_SYNC data: [fade 17][curve 3][on 1][level 11], the leader's state and
+// what is left of its transition. The fade is exact up to 65535 ms, longer
+// ones count in 32 ms units with the top bit set, so FADE_MAX_MS still fits.
+#define SYNC_CURVE_SHIFT (FADE_LEVEL_BITS + 1)
+#define SYNC_FADE_SHIFT (SYNC_CURVE_SHIFT + 3)
+#define SYNC_FADE(ms) ((ms) <= 0xFFFFu ? (uint32_t)(ms) : 0x10000u | (uint32_t)(ms) >> 5)
+#define SYNC_DATA(level, on, ms, curve) \
+    ((int32_t)((uint32_t)(level) | ((on) ? 1u << FADE_LEVEL_BITS : 0) | (uint32_t)(curve) << SYNC_CURVE_SHIFT | \
+               SYNC_FADE(ms) << SYNC_FADE_SHIFT)) // Pack EVENT_SYNC data
+_Static_assert(ANIM_CURVES <= 8, "curve doesn't fit EVENT_SYNC data");
+_Static_assert(FADE_MAX_MS >> 5 <= 0xFFFF, "longest fade doesn't fit EVENT_SYNC data");
+
+// Type of event coming from the interrupt callback or the remote control link
+typedef enum {
+    EVENT_BUTTON,
+    EVENT_ENCODER,
+    EVENT_SET_LEVEL, // Remote: switch on at a level
+    EVENT_SET_POWER, // Remote: switch on or off keeping the level
+    EVENT_FADE, // Remote: fade to a level over a duration
+    EVENT_SYNC, // Follower: take over the leader's brightness, on/off state and transition
+    EVENT_CLICK, // Gesture: short press released without turning, no second press followed
+    EVENT_DOUBLE_CLICK, // Gesture: two short presses, no third press followed
+    EVENT_LONG_PRESS, // Gesture: button held without turning
+    EVENT_PRESS_TURN, // Gesture: encoder turned while the button is held
+    EVENT_TRIPLE_CLICK, // Gesture: third short press in a row, posted on the press
+    EVENT_NIGHT_CAP, // Schedule: highest brightness from now on, MAX_BR lifts the cap
+    EVENT_COUNT // Number of event types
+} event_type;
+
+// Generic event passed from ISR to main loop through a queue, stored packed in 16 bits (see evq.h)
+typedef struct {
+    event_type type; // Source and meaning of data
+    int32_t data; // BUTTON: 1 = press, 0 = release; ENCODER: signed step count;
+                  // SET_LEVEL: level; SET_POWER: 1 = on, 0 = off; FADE: FADE_DATA(level, ms);
+                  // SYNC: SYNC_DATA(level, on, ms, curve); PRESS_TURN: signed step count; other gestures: 0;
+                  // NIGHT_CAP: highest brightness
+} event_t;
+
+// Dimmer state owned by the main loop
+typedef struct {
+    uint32_t brightness; // Brightness used while lights are on, kept while they are off
+    bool lights_on; // Indicates if LEDs are on or off
+    bool press_handled; // The current press switched the lights on or restored 50%, its click must not switch them off
+    uint32_t cct; // Colour temperature step, 0 warm .. CCT_MAX cool, used by DIMMER_CCT builds
+    uint32_t effect; // Lighting effect, 0 .. EFFECTS - 1, ends when the lights go off
+    uint32_t cap; // Highest brightness, below MAX_BR in night mode
+    uint32_t transition_ms; // Duration for the output to reach the level set by the last event
+    anim_curve transition_curve; // Shape of that transition
+} dimmer_t;
+
+void dimmer_init(dimmer_t *d); // Lights off, brightness at 50%, neutral white
+bool dimmer_handle_event(dimmer_t *d, const event_t *event); // Returns true if the output level, colour or effect changed
+uint32_t dimmer_level(const dimmer_t *d); // Compare value the LED channels move to
+bool dimmer_invariants_hold(const dimmer_t *d); // Checked after every transition
+uint32_t clamp(int32_t br); // returns value between 0 and MAX_BR
+
+#endif
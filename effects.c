@@ -0,0 +1,155 @@
+#include "effects.h"
+#include "leds.h"
+#include "hardware/dma.h"
+#include "hardware/pwm.h"
+
+#define BIT(m, b) (((m) >> (b)) & 1u)
+#define FX_SLICES (BIT(LED_SLICES, 0) + BIT(LED_SLICES, 1) + BIT(LED_SLICES, 2) + BIT(LED_SLICES, 3) + \
+                   BIT(LED_SLICES, 4) + BIT(LED_SLICES, 5) + BIT(LED_SLICES, 6) + BIT(LED_SLICES, 7)) // One DMA stream per LED slice
+#define RING_BITS (FX_SAMPLE_BITS + 2) // Bytes of one slice's waveform, as log2 for the DMA read ring
+#define BLOCKS (FX_SAMPLES / FX_BLOCK)
+#define STROBE_PERIOD 16 // Samples per strobe flash, 6.25 flashes per second at FX_SAMPLE_HZ
+
+_Static_assert(FX_SAMPLES % FX_BLOCK == 0, "waveform must hold whole blocks");
+_Static_assert(PWM_COUNTER_HZ / FX_SAMPLE_HZ <= 65536, "pacing period doesn't fit the PWM counter");
+_Static_assert(FX_SAMPLES % STROBE_PERIOD == 0, "strobe must repeat evenly across the loop");
+
+// CC words per LED slice, each row aligned to its size for the read ring
+static uint32_t wave[FX_SLICES][FX_SAMPLES] __attribute__((aligned(FX_SAMPLES * sizeof(uint32_t))));
+static uint16_t shape[FX_SAMPLES]; // Brightness of each sample, 65535 is the LED level
+static uint8_t slices[FX_SLICES]; // PWM slice of each wave row
+static int dma_chan[FX_SLICES];
+
+static fx_effect playing = FX_NONE;
+static uint32_t levels_rendered[LEDS_SIZE];
+static uint next_block; // Candle: next block to generate
+static uint32_t rng = 0x2545F491; // xorshift32 state, never zero
+static int32_t flame; // Candle: smoothed flicker, 0..65535
+
+void ini_fx(void) {
+    uint row = 0;
+    for (uint slice = 0; slice < PWM_SLICES; slice++) {
+        if (LED_SLICES & PIN_BIT(slice)) slices[row++] = (uint8_t)slice;
+    }
+
+    // Pacing slice drives no pin, its wrap DREQ is the sample clock
+    pwm_config config = pwm_get_default_config();
+    pwm_config_set_wrap(&config, PWM_COUNTER_HZ / FX_SAMPLE_HZ - 1);
+    pwm_init(FX_PACE_SLICE, &config, false);
+    set_pwm_clkdiv();
+
+    for (uint i = 0; i < FX_SLICES; i++) {
+        dma_chan[i] = dma_claim_unused_channel(true);
+        dma_channel_config c = dma_channel_get_default_config(dma_chan[i]);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+        channel_config_set_read_increment(&c, true);
+        channel_config_set_write_increment(&c, false);
+        channel_config_set_ring(&c, false, RING_BITS); // Loop over the waveform
+        channel_config_set_dreq(&c, pwm_get_dreq(FX_PACE_SLICE));
+        dma_channel_configure(dma_chan[i], &c, &pwm_hw->slice[slices[i]].cc, wave[i], UINT32_MAX, false);
+    }
+}
+
+static uint32_t xorshift(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+// CC words of samples [first, first + count) from the shape and LED levels
+static void render(const uint first, const uint count) {
+    for (uint s = first; s < first + count; s++) {
+        // Levels are at most MAX_BR, level * shape stays below 2^26
+        uint32_t scaled[LEDS_SIZE];
+        for (uint led = 0; led < LEDS_SIZE; led++) scaled[led] = levels_rendered[led] * shape[s] >> 16;
+        uint32_t cc[PWM_SLICES];
+        leds_slice_cc(scaled, cc);
+        for (uint i = 0; i < FX_SLICES; i++) wave[i][s] = cc[slices[i]];
+    }
+}
+
+// Smoothstep up over the first half and down over the second, never below 10%
+static void shape_breathe(void) {
+    for (uint s = 0; s < FX_SAMPLES; s++) {
+        const uint32_t half = FX_SAMPLES / 2;
+        const uint64_t x = (s < half ? s : FX_SAMPLES - s) * 65536 / half; // 0..65536
+        const uint32_t smooth = (uint32_t)((x * x >> 16) * (3 * 65536 - 2 * x) >> 16); // x^2 (3 - 2x) in Q16
+        shape[s] = (uint16_t)(6554 + (smooth > 65535 ? 65535 : smooth) * 9 / 10);
+    }
+}
+
+// Short flash about six times per second, a whole number of flashes per loop
+static void shape_strobe(void) {
+    for (uint s = 0; s < FX_SAMPLES; s++) shape[s] = s % STROBE_PERIOD < 2 ? 65535 : 0;
+}
+
+// One block of flicker: random targets between 60% and 100% with the odd deep
+// dip, smoothed so the flame wavers instead of jumping
+static void shape_candle_block(const uint block) {
+    for (uint s = block * FX_BLOCK; s < (block + 1) * FX_BLOCK; s++) {
+        const uint32_t r = xorshift();
+        const int32_t target = (r & 0x1F) == 0 ? 26214 : 39321 + (int32_t)((r >> 8) % 26215);
+        flame += (target - flame) >> 2;
+        shape[s] = (uint16_t)flame;
+    }
+}
+
+static void start(const fx_effect effect) {
+    if (effect == FX_BREATHE) shape_breathe();
+    if (effect == FX_STROBE) shape_strobe();
+    if (effect == FX_CANDLE) {
+        flame = 52428;
+        for (uint b = 0; b < BLOCKS; b++) shape_candle_block(b);
+        next_block = 0;
+    }
+    render(0, FX_SAMPLES);
+
+    // Take the registers over from the control tick and start every stream on the same wrap
+    leds_hold(true);
+    uint32_t mask = 0;
+    for (uint i = 0; i < FX_SLICES; i++) {
+        dma_channel_set_read_addr(dma_chan[i], wave[i], false);
+        dma_channel_set_trans_count(dma_chan[i], UINT32_MAX, false);
+        mask |= 1u << dma_chan[i];
+    }
+    dma_start_channel_mask(mask);
+    pwm_set_counter(FX_PACE_SLICE, 0);
+    pwm_set_enabled(FX_PACE_SLICE, true);
+}
+
+static void stop(void) {
+    pwm_set_enabled(FX_PACE_SLICE, false);
+    for (uint i = 0; i < FX_SLICES; i++) dma_channel_abort(dma_chan[i]);
+    leds_hold(false);
+}
+
+void fx_play(const fx_effect effect, const uint32_t levels[LEDS_SIZE]) {
+    bool levels_changed = false;
+    for (uint led = 0; led < LEDS_SIZE; led++) {
+        if (levels[led] != levels_rendered[led]) levels_changed = true;
+        levels_rendered[led] = levels[led];
+    }
+
+    if (effect != playing) {
+        if (playing != FX_NONE) stop();
+        playing = effect < FX_COUNT ? effect : FX_NONE;
+        if (playing != FX_NONE) start(playing);
+        return;
+    }
+    // Brightness moved, the DMA picks up the new words on its next lap
+    if (playing != FX_NONE && levels_changed) render(0, FX_SAMPLES);
+}
+
+void fx_poll(void) {
+    if (playing != FX_CANDLE) return;
+
+    // Replace blocks the DMA has finished with, never the one it is reading
+    const uint32_t read = (dma_channel_hw_addr(dma_chan[0])->read_addr - (uintptr_t)wave[0]) / sizeof(uint32_t);
+    const uint reading = (read % FX_SAMPLES) / FX_BLOCK;
+    while (next_block != reading) {
+        shape_candle_block(next_block);
+        render(next_block * FX_BLOCK, FX_BLOCK);
+        next_block = (next_block + 1) % BLOCKS;
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef EFFECTS_H
+#define EFFECTS_H
+
+// Lighting effects played by DMA. A waveform of CC register words per LED
+// slice sits in a RAM ring; one DMA channel per slice copies a word to the
+// slice's CC register at every wrap of FX_PACE_SLICE and the read ring wraps
+// around the buffer, so playback loops with no CPU involvement. Waveforms are
+// stored as a Q16 shape and rendered against the current LED levels, so an
+// effect follows the brightness. The candle is generated with a xorshift PRNG,
+// a block at a time behind the DMA read position.
+
+#include "pico/stdlib.h"
+#include "board.h"
+#include "dimmer.h"
+
+#define FX_SAMPLE_HZ 100 // Waveform samples per second
+#define FX_SAMPLE_BITS 8 // 2^FX_SAMPLE_BITS samples per loop, 2.56 s at FX_SAMPLE_HZ
+#define FX_SAMPLES (1u << FX_SAMPLE_BITS)
+#define FX_BLOCK 32 // Samples generated at a time for procedural effects
+
+// Effects in the order a triple click cycles through them
+typedef enum {
+    FX_NONE, // Steady light from the control tick
+    FX_BREATHE,
+    FX_CANDLE,
+    FX_STROBE,
+    FX_COUNT
+} fx_effect;
+_Static_assert(FX_COUNT == EFFECTS, "dimmer cycles through every effect");
+
+void ini_fx(void); // Claim DMA channels and set up the pacing slice
+void fx_play(fx_effect effect, const uint32_t levels[LEDS_SIZE]); // Main loop each control tick, FX_NONE stops
+void fx_poll(void); // Generate procedural blocks the DMA has played
+
+#endif
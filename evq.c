@@ -0,0 +1,133 @@
+#include "evq.h"
+#include "tasks.h"
+#include "pico/critical_section.h"
+
+#define TYPE_SHIFT 12
+#define WIDE_BIT (1u << 11)
+#define PAYLOAD_MASK (WIDE_BIT - 1)
+#define PAYLOAD_MIN (-1024)
+#define PAYLOAD_MAX 1023
+
+_Static_assert(EVENT_COUNT <= 1 << (16 - TYPE_SHIFT), "event types don't fit the packed type field");
+_Static_assert(MAX_BR <= PAYLOAD_MAX, "levels must fit inline");
+
+static uint16_t ring[EVQ_SIZE];
+static uint head; // Index of the oldest entry
+static volatile uint count; // Entries in use, read unlocked by evq_is_empty()
+static int32_t wide[EVQ_WIDE_SIZE]; // Payloads of wide entries, in queue order
+static uint wide_head;
+static uint wide_count;
+static critical_section_t lock; // Interrupts off, so an ISR can't interleave with the main loop
+static evq_stats_t stats;
+
+void ini_evq(void) {
+    critical_section_init(&lock);
+}
+
+static bool fits_inline(const int32_t data) {
+    return data >= PAYLOAD_MIN && data <= PAYLOAD_MAX;
+}
+
+static event_type entry_type(const uint16_t entry) {
+    return (event_type)(entry >> TYPE_SHIFT);
+}
+
+// Sign extend the inline payload
+static int32_t entry_payload(const uint16_t entry) {
+    return (int32_t)((entry & PAYLOAD_MASK) ^ (1u << 10)) - (1 << 10);
+}
+
+static uint16_t pack(const event_type type, const int32_t data) {
+    return (uint16_t)((uint)type << TYPE_SHIFT | ((uint32_t)data & PAYLOAD_MASK));
+}
+
+static void count_drop(const event_type type) {
+    if ((uint)type < EVENT_COUNT) stats.dropped[type]++;
+    stats.dropped_total++;
+}
+
+// Take the head entry, and its wide payload if it has one
+static uint16_t pop(int32_t *data) {
+    const uint16_t entry = ring[head];
+    head = (head + 1) % EVQ_SIZE;
+    count--;
+    if (entry & WIDE_BIT) {
+        *data = wide[wide_head];
+        wide_head = (wide_head + 1) % EVQ_WIDE_SIZE;
+        wide_count--;
+    }
+    else {
+        *data = entry_payload(entry);
+    }
+    return entry;
+}
+
+// Encoder steps only add up, so a full queue can absorb them into the newest entry.
+// A merged entry carries several steps, dimmer.c limits how far they move the level.
+static bool merge(const event_t *event) {
+    if (event->type != EVENT_ENCODER && event->type != EVENT_PRESS_TURN) return false;
+    uint16_t *tail = &ring[(head + count - 1) % EVQ_SIZE];
+    if (*tail & WIDE_BIT || entry_type(*tail) != event->type) return false;
+    const int32_t sum = entry_payload(*tail) + event->data;
+    if (!fits_inline(sum)) return false;
+    *tail = pack(event->type, sum);
+    stats.merged++;
+    return true;
+}
+
+bool evq_add(const event_t *event) {
+    const bool is_wide = !fits_inline(event->data);
+    bool added = true;
+    critical_section_enter_blocking(&lock);
+
+    if (is_wide && wide_count == EVQ_WIDE_SIZE) {
+        count_drop(event->type);
+        added = false;
+    }
+    else if (count == EVQ_SIZE) {
+        if (EVQ_POLICY == EVQ_MERGE_ENCODER && merge(event)) {
+            critical_section_exit(&lock);
+            return true;
+        }
+        if (EVQ_POLICY == EVQ_DROP_OLDEST) {
+            int32_t data;
+            count_drop(entry_type(pop(&data)));
+        }
+        else {
+            count_drop(event->type);
+            added = false;
+        }
+    }
+
+    if (added) {
+        if (is_wide) {
+            wide[(wide_head + wide_count) % EVQ_WIDE_SIZE] = event->data;
+            wide_count++;
+        }
+        ring[(head + count) % EVQ_SIZE] = is_wide ? pack(event->type, 0) | WIDE_BIT : pack(event->type, event->data);
+        count++;
+        if (count > stats.high_water) stats.high_water = count;
+    }
+    critical_section_exit(&lock);
+    if (added) tasks_signal();
+    return added;
+}
+
+bool evq_remove(event_t *event) {
+    critical_section_enter_blocking(&lock);
+    const bool any = count > 0;
+    if (any) {
+        const uint16_t entry = pop(&event->data);
+        event->type = entry_type(entry);
+    }
+    critical_section_exit(&lock);
+    return any;
+}
+
+bool evq_is_empty(void) {
+    return count == 0;
+}
+
+const evq_stats_t *evq_get_stats(void) {
+    return &stats;
+}
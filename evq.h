@@ -0,0 +1,53 @@
+#ifndef EVQ_H
+#define EVQ_H
+
+// Event queue between the interrupt handlers and the main loop. Any context
+// may add, only the main loop removes. When the queue is full EVQ_POLICY
+// decides what is lost, and every loss is counted per event type so the
+// queue can be sized from what happens in use.
+//
+// Entries are packed into 16 bits: [type 4][wide 1][payload 11]. Button,
+// encoder and gesture events carry small payloads and fit inline. Payloads
+// outside the signed 11-bit range (fades, sync state) set the wide bit and
+// take the next slot of a small FIFO of 32-bit values, which is consumed in
+// the same order, so events stay in order.
+
+#include "pico/stdlib.h"
+#include "dimmer.h"
+
+// Queue depth needed by input interrupts: the fastest event rate by hand for
+// the longest time the input task can be kept waiting with interrupts enabled.
+// The scheduler runs input after whatever task is already running, so that
+// is the longest single task run, the max_us of tasks_report() (FreeRTOS
+// builds: of the tasks on input's core that input can't preempt). A flash erase
+// or program doesn't count: flash_op() disables interrupts, nothing is queued
+// and GPIO edges wait latched, so subtract that time from persist's max_us.
+// Check against stats.high_water.
+#define EVQ_MAX_RATE_HZ 400 // Encoder steps and button edges per second, fast spin with margin
+#define EVQ_MAX_STALL_MS 20 // Longest task run with interrupts enabled, the budget every task keeps to
+#define EVQ_SIZE (EVQ_MAX_RATE_HZ * EVQ_MAX_STALL_MS / 1000) // Packed entries, 2 bytes each
+#define EVQ_WIDE_SIZE 8 // Wide payloads, posted by the main loop (remote, UDP, sync) and the schedule alarm
+
+// What to do with an event that finds the queue full
+#define EVQ_DROP_NEWEST 0 // Keep the queue, lose the new event
+#define EVQ_DROP_OLDEST 1 // Lose the event at the head to make room
+#define EVQ_MERGE_ENCODER 2 // Add encoder steps to a matching tail entry, otherwise drop newest
+#ifndef EVQ_POLICY
+#define EVQ_POLICY EVQ_MERGE_ENCODER
+#endif
+
+// Queue counters, also part of the PROTO_STATS reply
+typedef struct {
+    uint32_t dropped[EVENT_COUNT]; // Events lost to overflow, by type
+    uint32_t dropped_total;
+    uint32_t merged; // Encoder events folded into the tail entry
+    uint32_t high_water; // Deepest the queue has been, in packed entries
+} evq_stats_t;
+
+void ini_evq(void);
+bool evq_add(const event_t *event); // Any context; false if the event itself was dropped
+bool evq_remove(event_t *event); // Main loop only; false when empty
+bool evq_is_empty(void);
+const evq_stats_t *evq_get_stats(void);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+// Q16 fixed point and compile-time lookup tables, shared by the SDK-free modules
+
+#include <stdint.h>
+
+typedef uint32_t q16_t; // Unsigned fixed point, 16 fractional bits
+#define Q16(x) ((q16_t)(x) << 16)
+#define Q16_ROUND(q) (((q) + 0x8000u) >> 16) // Nearest integer
+
+static inline q16_t q16_mul(const q16_t a, const q16_t b) {
+    return (q16_t)(((uint64_t)a * b) >> 16);
+}
+
+// Initializer of a 65-entry table, TABLE65(f) expands f(0) .. f(64). f(i) must
+// end with a comma and be a constant expression, so the compiler computes the
+// table and it can live in flash.
+#define TABLE65_4(f, i) f(i) f(i + 1) f(i + 2) f(i + 3)
+#define TABLE65_16(f, i) TABLE65_4(f, i) TABLE65_4(f, i + 4) TABLE65_4(f, i + 8) TABLE65_4(f, i + 12)
+#define TABLE65(f) { TABLE65_16(f, 0) TABLE65_16(f, 16) TABLE65_16(f, 32) TABLE65_16(f, 48) f(64) }
+
+#endif
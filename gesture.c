@@ -0,0 +1,95 @@
+#include "gesture.h"
+#include "dimmer.h"
+#include "evq.h"
+#include "logger.h"
+#include "hardware/timer.h"
+
+// Recognizer state, touched only by the GPIO and timer interrupts (same priority, never nested)
+typedef enum {
+    GESTURE_IDLE,
+    GESTURE_PRESSED, // Down, long press alarm armed
+    GESTURE_TURNING, // Down and turned, release ends it silently
+    GESTURE_LONG, // Down after the long press fired
+    GESTURE_DOUBLE, // Second press is down
+    GESTURE_TRIPLE, // Third press is down, the triple click is posted
+    GESTURE_WAIT_SECOND, // Released after one press, a click unless the alarm sees a second press first
+    GESTURE_WAIT_THIRD // Released after two presses, a double click unless a third press comes first
+} gesture_state;
+
+static volatile gesture_state state = GESTURE_IDLE;
+static int alarm_num = -1;
+
+static void post(const event_type type, const int32_t data) {
+    const event_t event = { .type = type, .data = data };
+    if (!evq_add(&event)) log_isr("gesture event dropped:", type); // Add event to queue
+}
+
+static void arm(const uint32_t ms) {
+    hardware_alarm_set_target(alarm_num, make_timeout_time_ms(ms));
+}
+
+// Hardware alarm callback, ends a long press wait or a click window. A click
+// or double click is only posted once no further press can extend it.
+static void alarm_callback(const uint alarm) {
+    if (state == GESTURE_PRESSED) {
+        state = GESTURE_LONG;
+        post(EVENT_LONG_PRESS, 0);
+    }
+    else if (state == GESTURE_WAIT_SECOND) {
+        state = GESTURE_IDLE;
+        post(EVENT_CLICK, 0);
+    }
+    else if (state == GESTURE_WAIT_THIRD) {
+        state = GESTURE_IDLE;
+        post(EVENT_DOUBLE_CLICK, 0);
+    }
+}
+
+void ini_gesture(void) {
+    alarm_num = hardware_alarm_claim_unused(true);
+    hardware_alarm_set_callback(alarm_num, alarm_callback);
+}
+
+void gesture_button(const bool pressed) {
+    if (pressed) {
+        if (state == GESTURE_WAIT_SECOND) {
+            hardware_alarm_cancel(alarm_num);
+            state = GESTURE_DOUBLE;
+            return;
+        }
+        if (state == GESTURE_WAIT_THIRD) {
+            hardware_alarm_cancel(alarm_num);
+            state = GESTURE_TRIPLE;
+            post(EVENT_TRIPLE_CLICK, 0);
+            return;
+        }
+        state = GESTURE_PRESSED;
+        post(EVENT_BUTTON, 1);
+        arm(LONG_PRESS_MS);
+        return;
+    }
+
+    post(EVENT_BUTTON, 0);
+    if (state == GESTURE_PRESSED) {
+        // Short press without turning, a second press may still make it a double click
+        hardware_alarm_cancel(alarm_num);
+        state = GESTURE_WAIT_SECOND;
+        arm(DOUBLE_CLICK_MS);
+    }
+    else if (state == GESTURE_DOUBLE) {
+        // A third press within the same window makes it a triple click
+        state = GESTURE_WAIT_THIRD;
+        arm(DOUBLE_CLICK_MS);
+    }
+    else if (state != GESTURE_WAIT_SECOND && state != GESTURE_WAIT_THIRD) {
+        state = GESTURE_IDLE;
+    }
+}
+
+bool gesture_encoder(const int32_t step) {
+    if (state != GESTURE_PRESSED && state != GESTURE_TURNING) return false;
+    if (state == GESTURE_PRESSED) hardware_alarm_cancel(alarm_num);
+    state = GESTURE_TURNING;
+    post(EVENT_PRESS_TURN, step);
+    return true;
+}
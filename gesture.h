@@ -0,0 +1,23 @@
+#ifndef GESTURE_H
+#define GESTURE_H
+
+// ROT_SW gesture recognizer. Debounced button edges and encoder steps from
+// the GPIO callback go in; clicks, double and triple clicks, long presses and
+// press-and-turn steps come out as events. Timeouts run on a one-shot
+// hardware alarm that is only armed while a gesture is in progress.
+// A run of presses yields one click event: a click or double click waits
+// DOUBLE_CLICK_MS after its last release to be sure no further press follows,
+// a triple click is posted on its third press. Switching off on a click is
+// therefore delayed by DOUBLE_CLICK_MS; anything that must feel immediate is
+// done on the EVENT_BUTTON press instead (see dimmer.c).
+
+#include "pico/stdlib.h"
+
+#define LONG_PRESS_MS 600 // Hold time for a long press
+#define DOUBLE_CLICK_MS 300 // Window after a click for the next press of a double or triple click
+
+void ini_gesture(void); // Claim the hardware alarm
+void gesture_button(bool pressed); // Debounced button edge, ISR or interrupts disabled
+bool gesture_encoder(int32_t step); // Encoder step; returns true if it was taken as press-and-turn
+
+#endif
@@ -0,0 +1,140 @@
+#include "leds.h"
+#include "board.h"
+#include "dimmer.h"
+#include "hardware/clocks.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "tasks.h"
+
+#define WRAP_SLICE PWM_SLICE(LED_R) // Slice whose wrap interrupt runs the control tick
+
+#define LEVEL_BITS 10 // Bits per LED in a packed word
+#define LEVEL_MASK ((1u << LEVEL_BITS) - 1)
+#define LEVEL(packed, led) (((packed) >> ((led) * LEVEL_BITS)) & LEVEL_MASK)
+_Static_assert(MAX_BR <= LEVEL_MASK && LEDS_SIZE * LEVEL_BITS <= 32, "LED levels don't pack into one word");
+
+static volatile uint32_t tick_levels; // Packed levels for the next control tick
+static volatile uint32_t applied_levels; // Packed levels in the compare registers
+static volatile bool tick_pending; // Set by the interrupt, cleared by leds_tick()
+static volatile bool held; // Another writer (effects DMA) owns the compare registers
+static uint wraps; // PWM periods since the last control tick
+static leds_stats_t stats;
+
+static void pwm_wrap_callback(void);
+
+// PWM divider for the current clk_sys in 8.4 fixed point
+static uint32_t pwm_div16(void) {
+    // Every supported clk_sys is a multiple of PWM_COUNTER_HZ / 16,
+    // so the PWM frequency stays exact and TOP never changes.
+    return clock_get_hz(clk_sys) * 16 / PWM_COUNTER_HZ;
+}
+
+void ini_leds(void) {
+    // Get default PWM configuration
+    pwm_config config = pwm_get_default_config();
+    // Set clock divider for a PWM_COUNTER_HZ counter
+    const uint32_t div16 = pwm_div16();
+    pwm_config_set_clkdiv_int_frac(&config, div16 >> 4, div16 & 0xf);
+    // Set wrap (TOP)
+    pwm_config_set_wrap(&config, TOP);
+
+    // Initialize each slice used by an LED once, compare values start at 0
+    for (uint slice = 0; slice < PWM_SLICES; slice++) {
+        if (LED_SLICES & PIN_BIT(slice)) pwm_init(slice, &config, false); // Start set to false
+    }
+
+    // Select PWM model for your pin
+    gpio_set_function(LED_R, GPIO_FUNC_PWM);
+    gpio_set_function(LED_M, GPIO_FUNC_PWM);
+    gpio_set_function(LED_L, GPIO_FUNC_PWM);
+
+    // Start every LED slice with the same register write so their periods line up
+    hw_set_bits(&pwm_hw->en, LED_SLICES);
+
+    // Wrap interrupt of one LED slice drives the control tick
+    irq_set_exclusive_handler(PWM_IRQ_WRAP, pwm_wrap_callback);
+    pwm_clear_irq(WRAP_SLICE);
+    pwm_set_irq_enabled(WRAP_SLICE, true);
+    irq_set_enabled(PWM_IRQ_WRAP, true);
+}
+
+static uint32_t pack(const uint32_t levels[LEDS_SIZE]) {
+    uint32_t packed = 0;
+    for (uint led = 0; led < LEDS_SIZE; led++) {
+        packed |= (levels[led] > MAX_BR ? MAX_BR : levels[led]) << (led * LEVEL_BITS);
+    }
+    return packed;
+}
+
+// Compare value for one LED pin, shifted to its channel of the slice
+#define CC(pin, level) (PWM_CHAN(pin) ? (level) << PWM_CH0_CC_B_LSB : (level))
+
+void leds_slice_cc(const uint32_t levels[LEDS_SIZE], uint32_t cc[PWM_SLICES]) {
+    // Pins are compile-time constants, so the slice and channel arithmetic folds away.
+    // Channels of an LED slice that aren't LEDs are held at 0.
+    for (uint slice = 0; slice < PWM_SLICES; slice++) cc[slice] = 0;
+    cc[PWM_SLICE(LED_R)] |= CC(LED_R, levels[0]);
+    cc[PWM_SLICE(LED_M)] |= CC(LED_M, levels[1]);
+    cc[PWM_SLICE(LED_L)] |= CC(LED_L, levels[2]);
+}
+
+static void write_levels(const uint32_t packed) {
+    // One CC register write per LED slice
+    const uint32_t levels[LEDS_SIZE] = { LEVEL(packed, 0), LEVEL(packed, 1), LEVEL(packed, 2) };
+    uint32_t cc[PWM_SLICES];
+    leds_slice_cc(levels, cc);
+#pragma GCC unroll 8
+    for (uint slice = 0; slice < PWM_SLICES; slice++) {
+        if (LED_SLICES & PIN_BIT(slice)) pwm_hw->slice[slice].cc = cc[slice];
+    }
+    applied_levels = packed;
+}
+
+void set_brightness(const uint32_t levels[LEDS_SIZE]) {
+    write_levels(pack(levels));
+}
+
+void leds_set_levels(const uint32_t levels[LEDS_SIZE]) {
+    tick_levels = pack(levels);
+}
+
+void leds_hold(const bool hold) {
+    held = hold;
+    // Whatever the other writer left in the registers is replaced at the next tick
+    if (!hold) applied_levels = UINT32_MAX;
+}
+
+bool leds_tick(void) {
+    if (!tick_pending) return false;
+    tick_pending = false;
+    return true;
+}
+
+// PWM wrap interrupt. Every CONTROL_TICK_WRAPS periods it copies the latest
+// levels to the compare registers and flags the tick; the dimming logic itself
+// stays in the main loop.
+static void pwm_wrap_callback(void) {
+    pwm_clear_irq(WRAP_SLICE);
+    if (++wraps < CONTROL_TICK_WRAPS) return;
+    wraps = 0;
+
+    const uint32_t packed = tick_levels;
+    if (!held && packed != applied_levels) {
+        write_levels(packed);
+        stats.updates++;
+    }
+    stats.ticks++;
+    tick_pending = true;
+    tasks_signal();
+}
+
+void set_pwm_clkdiv(void) {
+    const uint32_t div16 = pwm_div16();
+    for (uint slice = 0; slice < PWM_SLICES; slice++) {
+        if ((LED_SLICES | PIN_BIT(FX_PACE_SLICE)) & PIN_BIT(slice)) pwm_set_clkdiv_int_frac(slice, div16 >> 4, div16 & 0xf);
+    }
+}
+
+const leds_stats_t *leds_get_stats(void) {
+    return &stats;
+}
@@ -0,0 +1,32 @@
+#ifndef LEDS_H
+#define LEDS_H
+
+// PWM output for the LEDs listed in board.h. The main loop hands over a
+// level whenever it likes; the PWM wrap interrupt writes it to the compare
+// registers once per control tick, so register traffic and update timing
+// don't depend on how many events arrived. The three levels travel packed in
+// one word, so the interrupt never sees half of an update.
+
+#include "pico/stdlib.h"
+#include "board.h"
+
+#define PWM_COUNTER_HZ 1000000 // PWM counter clock, the divider is clk_sys / PWM_COUNTER_HZ (125 at 125 MHz)
+#define CONTROL_TICK_WRAPS 10 // PWM periods per control tick, 10 ms at the 1 kHz PWM frequency
+
+// Control tick counters
+typedef struct {
+    uint32_t ticks; // Control ticks since boot
+    uint32_t updates; // Ticks that wrote a new level to the compare registers
+} leds_stats_t;
+
+void ini_leds(void); // Initialize LED pins and PWM, all LED slices start in phase
+// levels[] holds one compare value per LED in the order LED_R, LED_M, LED_L
+void set_brightness(const uint32_t levels[LEDS_SIZE]); // Write levels right away, for the first light after boot
+void leds_set_levels(const uint32_t levels[LEDS_SIZE]); // Levels to apply at the next control tick
+bool leds_tick(void); // True once after each control tick, main loop only
+void leds_hold(bool hold); // Stop or resume control tick writes while another writer owns the registers
+void leds_slice_cc(const uint32_t levels[LEDS_SIZE], uint32_t cc[PWM_SLICES]); // CC register word of each slice
+void set_pwm_clkdiv(void); // Match PWM dividers of the LED and effect pacing slices to the current clk_sys
+const leds_stats_t *leds_get_stats(void);
+
+#endif
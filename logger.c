@@ -0,0 +1,128 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include "logger.h"
+#include "hardware/dma.h"
+#include "hardware/sync.h"
+#include "hardware/uart.h"
+#include "pico/critical_section.h"
+
+#define LOG_BUF_MASK (LOG_BUF_SIZE - 1)
+
+// Message posted from an ISR, formatted later by log_poll()
+typedef struct {
+    const char *msg;
+    int32_t value;
+} log_isr_msg_t;
+
+// Bytes waiting for the UART. The DMA read address wraps at a LOG_BUF_SIZE boundary, so the buffer must start on one
+static uint8_t ring[LOG_BUF_SIZE] __attribute__((aligned(LOG_BUF_SIZE)));
+static uint32_t head; // Free-running write index, moved under lock
+static uint32_t tail; // Free-running index of the first byte not yet sent
+static uint32_t in_flight; // Bytes handed to the DMA channel
+
+static log_isr_msg_t isr_msgs[LOG_ISR_SLOTS];
+static volatile uint32_t isr_head; // Written by the ISR only
+static volatile uint32_t isr_tail; // Written by the main loop only
+
+static critical_section_t lock; // FreeRTOS builds log from tasks on both cores
+static int dma_chan = -1;
+static log_stats_t stats;
+
+void ini_log(void) {
+    critical_section_init(&lock);
+    dma_chan = dma_claim_unused_channel(true);
+
+    dma_channel_config config = dma_channel_get_default_config(dma_chan);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_ring(&config, false, LOG_BUF_BITS); // Wrap reads around the ring
+    channel_config_set_dreq(&config, uart_get_dreq(uart_default, true));
+    dma_channel_configure(dma_chan, &config, &uart_get_hw(uart_default)->dr, ring, 0, false);
+}
+
+void log_printf(const char *fmt, ...) {
+    char line[LOG_LINE_MAX];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len < 0) return;
+    if (len >= (int)sizeof(line)) len = sizeof(line) - 1;
+    log_write(line, len);
+}
+
+bool log_write(const void *data, const size_t len) {
+    // Messages are short, copying under the lock keeps each one whole and in
+    // order, and head never covers bytes another writer hasn't copied yet
+    critical_section_enter_blocking(&lock);
+    // Drop the whole message rather than sending part of it
+    const bool fits = LOG_BUF_SIZE - (head - tail) >= len;
+    if (fits) {
+        const uint8_t *bytes = data;
+        for (size_t i = 0; i < len; i++) {
+            ring[(head + i) & LOG_BUF_MASK] = bytes[i];
+        }
+        head += len;
+        stats.messages++;
+    }
+    else {
+        stats.dropped++;
+    }
+    critical_section_exit(&lock);
+    return fits;
+}
+
+void log_isr(const char *msg, const int32_t value) {
+    const uint32_t h = isr_head;
+    if (h - isr_tail >= LOG_ISR_SLOTS) {
+        stats.isr_dropped++;
+        return;
+    }
+    isr_msgs[h & (LOG_ISR_SLOTS - 1)] = (log_isr_msg_t){ .msg = msg, .value = value };
+    __dmb(); // Slot contents must be visible before the index moves
+    isr_head = h + 1;
+}
+
+void log_poll(void) {
+    // Format messages posted by interrupts
+    while (isr_tail != isr_head) {
+        const log_isr_msg_t m = isr_msgs[isr_tail & (LOG_ISR_SLOTS - 1)];
+        __dmb();
+        isr_tail = isr_tail + 1;
+        log_printf("%s %d\n", m.msg, m.value);
+    }
+
+    if (dma_chan < 0) return;
+
+    // Release bytes of the finished transfer
+    if (in_flight && !dma_channel_is_busy(dma_chan)) {
+        tail += in_flight;
+        in_flight = 0;
+    }
+
+    // Send everything queued so far in one transfer, the read ring handles the wrap
+    if (!in_flight && head != tail) {
+        in_flight = head - tail;
+        dma_channel_set_read_addr(dma_chan, &ring[tail & LOG_BUF_MASK], false);
+        dma_channel_set_trans_count(dma_chan, in_flight, true);
+    }
+}
+
+bool log_idle(void) {
+    // The UART is busy until the last character handed over by DMA has left the shift register
+    return head == tail && isr_head == isr_tail && (dma_chan < 0 || !dma_channel_is_busy(dma_chan)) &&
+           !(uart_get_hw(uart_default)->fr & UART_UARTFR_BUSY_BITS);
+}
+
+void log_flush(void) {
+    if (dma_chan < 0) return;
+    while (!log_idle()) {
+        log_poll();
+    }
+    uart_default_tx_wait_blocking();
+}
+
+const log_stats_t *log_get_stats(void) {
+    return &stats;
+}
@@ -0,0 +1,30 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+// Non-blocking diagnostics over the stdio UART. Messages are formatted into a
+// RAM ring and drained to the UART by DMA, so logging never waits for the wire.
+
+#include "pico/stdlib.h"
+
+#define LOG_BUF_BITS 11 // Ring holds 2^LOG_BUF_BITS bytes, DMA wraps on this boundary
+#define LOG_BUF_SIZE (1u << LOG_BUF_BITS)
+#define LOG_LINE_MAX 96 // Longest formatted message, longer ones are truncated
+#define LOG_ISR_SLOTS 16 // Pending ISR messages, must be a power of two
+
+// Logger counters
+typedef struct {
+    uint32_t messages; // Messages accepted into the ring
+    uint32_t dropped; // Messages dropped because the ring was full
+    uint32_t isr_dropped; // ISR messages dropped because their slots were full
+} log_stats_t;
+
+void ini_log(void); // Claim the DMA channel, call after stdio_init_all()
+void log_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2))); // Any task, not ISRs
+bool log_write(const void *data, size_t len); // Queue raw bytes as one message, any task, not ISRs
+void log_isr(const char *msg, int32_t value); // ISR safe; msg must be a string literal
+void log_poll(void); // Format ISR messages and start the next DMA transfer
+bool log_idle(void); // True when nothing is queued, in flight or still leaving the UART
+void log_flush(void); // Block until everything queued is sent
+const log_stats_t *log_get_stats(void);
+
+#endif
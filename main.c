@@ -1,101 +1,247 @@
 #include <stdio.h>
 #include "pico/stdlib.h"
-#include "hardware/pwm.h"
 #include "hardware/gpio.h"
+#include "hardware/sync.h"
 #include <stdbool.h>
-#include "pico/util/queue.h"
 
-#define CLK_DIV 125 // PWM clock divider
-#define TOP 999 // PWM counter top value
-
-#define ROT_A 10 // Rotary encoder input without pull-up/pull-down
-#define ROT_B 11 // Rotary encoder input without pull-up/pull-down
-#define ROT_SW 12 // Rotary encoder input with pull-up
+#include "board.h"
+#include "dimmer.h"
+#include "evq.h"
+#include "leds.h"
+#include "power.h"
+#include "persist.h"
+#include "logger.h"
+#include "remote.h"
+#include "net.h"
+#include "sync.h"
+#include "gesture.h"
+#include "pipeline.h"
+#include "sense.h"
+#include "effects.h"
+#include "strip.h"
+#include "schedule.h"
+#include "tasks.h"
+#include "coro.h"
+#include "behaviour.h"
+
+#ifndef DIMMER_WIFI
+#define DIMMER_WIFI 0 // Set by the DIMMER_WIFI CMake option
+#endif
+
+#define BOOT_LEVEL (-1) // Power-on level: -1 restores the persisted state, 0..MAX_BR switches on at that level
 
 #define DEBOUNCE_MS 20 // Debounce delay in milliseconds
 
-#define LED_R 22 // right LED pin
-#define LED_M 21 // middle LED pin
-#define LED_L 20 // left LED pin
-#define LEDS_SIZE 3 // number of LEDs
-
-#define BR_RATE 50 // step size for brightness change
-#define MAX_BR (TOP + 1) // max brightness
-#define BR_MID (MAX_BR / 2) // 50% brightness level
-
-// Type of event coming from the interrupt callback
-typedef enum { EVENT_BUTTON, EVENT_ENCODER } event_type;
+#define ANIM_LEVEL 0 // Animation channel of the output level
+#define ANIM_CCT 1 // Animation channel of the colour temperature
+#define TASKS_REPORT_MS 60000 // Interval of the task run-time report in the log
 
-// Generic event passed from ISR to main loop through a queue
-typedef struct {
-    event_type type; // EVENT_BUTTON or EVENT_ENCODER
-    int32_t data; // BUTTON: 1 = press, 0 = release; ENCODER: +1 or -1 step
-} event_t;
-
-// Global event queue used by ISR (Interrupt Service Routine) and main loop
-static queue_t events;
+// Main loop state, shared by the tasks below
+static dimmer_t dimmer; // Brightness and on/off state
+static anim_t anim; // Output level on its way to the dimmer level
+static uint32_t idle_since_ms; // Last time an event changed the state
+static bool run_clock_wanted; // A change asked for POWER_RUN_KHZ, switched once the log is idle
 
 void gpio_callback(uint gpio, uint32_t event_mask);
-void ini_rot(const uint *rots); // Initialize rotary encoder
-void ini_leds(const uint *leds); // Initialize LED pins and PWM
-bool light_switch(const uint *leds, uint brightness, bool on); // Turn lights on/off
-void set_brightness(const uint *leds, uint brightness); // Increase/decrease lighting
-uint clamp(int br); // returns value between 0 and TOP
+void ini_rot(void); // Initialize rotary encoder
+void output_levels(const anim_t *anim, uint32_t levels[LEDS_SIZE]); // Compare values for the animated output
+uint32_t strip_output_level(const anim_t *anim); // Global strip brightness for the animated output
+void input_task(void); // Hand queued events to the dimmer and start the transitions
+void control_task(void); // One control tick of sensing, animation and output
+void link_task(void); // Remote, Wi-Fi and sync links
+void power_idle(void); // Dormant and clock scaling when there is nothing to do
+bool input_ready(void); // Events are queued
+void behaviour_task(void); // Resume the behaviours their signals woke
+
+// Main loop tasks, highest priority first. Input preempts everything queued
+// behind it; persistence and logging only run when the rest is done.
+// FreeRTOS builds keep the tasks that own the dimmer state on core 0, the
+// interpolators used by the output pipeline are that core's; the links and
+// the log are the background on core 1. There the control tick gets the top
+// priority of its own, so no other work holds up the next output level.
+static const task_t tasks[] = {
+    { "input", TASK_EVENT, input_ready, 0, input_task, 0, 2 },
+    { "control", TASK_EVENT, leds_tick, 0, control_task, 0, 3 },
+    { "behaviour", TASK_EVENT, coro_pending, 0, behaviour_task, 0, 2 },
+    { "link", TASK_TIMER, NULL, 10, link_task, 1, 1 },
+    { "persist", TASK_TIMER, NULL, 10, persist_poll, 0, 2 }, // Write the state to flash once the knob has been still for a while
+    { "log", TASK_TIMER, NULL, 10, log_poll, 1, 1 }, // Keep the log DMA busy
+    { "report", TASK_TIMER, NULL, TASKS_REPORT_MS, tasks_report, 1, 1 },
+    { "power", TASK_IDLE, NULL, 0, power_idle, 0, 0 }
+};
 
 int main() {
-    // LED and rotary encoder pin arrays for easier iteration
-    const uint leds[] = {LED_R, LED_M, LED_L};
-    const uint rots[] = {ROT_A, ROT_B, ROT_SW};
-
-    uint brightness = BR_MID; // Current LEDs brightness value
-    static bool lightsOn = false; // Indicates if LEDs are on or off
+    dimmer_init(&dimmer);
+    anim_init(&anim);
+#if BOOT_LEVEL < 0
+    // Continue from the state saved before power was lost
+    persist_load(&dimmer);
+#else
+    dimmer.brightness = clamp(BOOT_LEVEL);
+    dimmer.lights_on = true;
+#endif
+
+    // Bring the lights back before anything slower is initialized
+    ini_pipeline();
+    ini_leds();
+    anim_set(&anim, ANIM_LEVEL, Q16(dimmer_level(&dimmer)));
+    anim_set(&anim, ANIM_CCT, Q16(dimmer.cct));
+    uint32_t levels[LEDS_SIZE];
+    output_levels(&anim, levels);
+    leds_set_levels(levels);
+    set_brightness(levels);
+    // Timer starts when the runtime sets up clocks right after reset, so this is boot to first light
+    const uint32_t first_light_us = time_us_32();
 
+    // Initialize rotary encoder pins
+    ini_rot();
     // Initialize chosen serial port
     stdio_init_all();
-    // Initialize LED pins and PWM
-    ini_leds(leds);
-    // Initialize rotary encoder pins
-    ini_rot(rots);
+    // Drain diagnostics to the UART by DMA
+    ini_log();
+    log_printf("boot to first light: %u us\n", first_light_us);
+    if (PIPELINE_BENCH) pipeline_bench();
+    // Accept commands from a controller on the same UART
+    ini_remote();
+#if DIMMER_WIFI
+    // Join the network in the background and listen for UDP commands
+    if (!ini_net(&net_lwip_transport, evq_add)) log_printf("Wi-Fi init failed\n");
+#endif
+    // Leader/follower brightness sync with other boards in the room
+    ini_sync(evq_add);
+    // Ambient light and die temperature, sampled by the ADC and DMA in the background
+    ini_sense();
+    // Waveform effects played into the PWM by DMA
+    ini_fx();
+    // Addressable strip, white at the dimmer level until something draws on it
+    ini_strip();
+    strip_fill(255, 255, 255);
+    // Timed on/off, sunrise and night mode, armed once a controller sets the clock
+    ini_schedule();
+
+    idle_since_ms = to_ms_since_boot(get_absolute_time());
+    // Dispatch the tasks by priority, the core sleeps in WFE when none is ready
+    tasks_run(tasks, sizeof(tasks) / sizeof(tasks[0]));
+}
 
+// Switch back to POWER_RUN_KHZ once the log UART is quiet. Its baud rate
+// changes with the clock, and waiting for a log burst to drain would hold up
+// input by tens of milliseconds, so until then the output keeps the low clock.
+static void restore_run_clock(void) {
+    if (!run_clock_wanted || !log_idle()) return;
+    run_clock_wanted = false;
+    if (power_set_sys_khz(POWER_RUN_KHZ)) {
+        set_pwm_clkdiv();
+        strip_set_clkdiv();
+    }
+}
+
+void input_task(void) {
+    const uint32_t now_ms = to_ms_since_boot(get_absolute_time());
     event_t event;
-    while (true) {
-
-        // Process all pending events from the queue
-        while (queue_try_remove(&events, &event)) {
-
-            // Handle button events
-            if (event.type == EVENT_BUTTON && event.data == 1) {
-                // Turn lights on
-                if (!lightsOn) {
-                    lightsOn = light_switch(leds, brightness, true);
-                }
-                else {
-                    // If LEDs are on and brightness is 0%, restore to 50%
-                    if (brightness <= 0) {
-                        brightness = BR_MID;
-                        set_brightness(leds, BR_MID);
-                    }
-                    // Otherwise turn lights off
-                    else {
-                        lightsOn = light_switch(leds, 0, false);
-                    }
-                }
+    // The control tick reads the dimmer and the animation, it must not see them half updated
+    tasks_lock();
+    // Process all pending events from the queue
+    while (evq_remove(&event)) {
+        // A burst of events only changes the state, the LEDs see the net result at the next tick
+        if (dimmer_handle_event(&dimmer, &event)) {
+            idle_since_ms = now_ms;
+            // A change ends the idle clock, transitions and effects run at full speed.
+            // Events that change nothing, like a follower's periodic ABS frame, leave it low.
+            run_clock_wanted = true;
+            // Head for the new level from wherever the output is now
+            anim_start(&anim, ANIM_LEVEL, Q16(dimmer_level(&dimmer)), dimmer.transition_ms, dimmer.transition_curve,
+                       now_ms);
+            anim_start(&anim, ANIM_CCT, Q16(dimmer.cct), dimmer.transition_ms, dimmer.transition_curve, now_ms);
+            persist_save_later(&dimmer);
+            // Report restore time on the first update after a wake-up
+            if (power_mark_first_light()) {
+                log_printf("wake to first light: %u us\n", power_get_stats()->last_wake_us);
             }
+        }
+        if (event.type == EVENT_LONG_PRESS) behaviour_long_press(&anim, now_ms);
+    }
+    tasks_unlock();
+    restore_run_clock();
+}
 
-            // Handle encoder rotation events only when lights are on
-            if (event.type == EVENT_ENCODER && lightsOn) {
-                // Update brightness according to rotation direction and clamp to valid range
-                brightness = clamp((int)brightness + (int)(event.data * BR_RATE));
-                set_brightness(leds, brightness);
-            }
+void control_task(void) {
+    // Input that found the log busy gets its clock at a later tick
+    restore_run_clock();
+    // Filter the sensors, update derating and move the output one control tick along, written to the PWM by the wrap interrupt at the next tick
+    sense_tick();
+    anim_tick(&anim, to_ms_since_boot(get_absolute_time()));
+    uint32_t levels[LEDS_SIZE];
+    output_levels(&anim, levels);
+    leds_set_levels(levels);
+    // An effect takes the registers over and plays against the same levels
+    fx_play((fx_effect)dimmer.effect, levels);
+    fx_poll();
+    strip_set_level(strip_output_level(&anim));
+    strip_poll();
+    // Behaviours waiting on the tick or a deadline go next
+    coro_signal(CORO_TICK);
+}
+
+void behaviour_task(void) {
+    coro_run(to_ms_since_boot(get_absolute_time()));
+}
+
+void link_task(void) {
+    // Decode controller frames, commands are queued for the input task
+    remote_poll(&dimmer);
+    net_poll();
+    sync_poll(&dimmer);
+}
+
+void power_idle(void) {
+    // Go dormant while the lights are off, nothing is queued and the button is released.
+    // The radio needs clk_sys running at the rate it was set up with, so Wi-Fi builds stay awake.
+    // The timer stops in dormant, a board with a schedule to keep stays awake as well (see schedule.h).
+    // A sync follower gets an ABS frame every SYNC_ABS_MS, it would wake for each and lose it.
+    if (!DIMMER_WIFI && SYNC_ROLE != SYNC_FOLLOWER && !schedule_armed() && !dimmer.lights_on && !anim_busy(&anim) &&
+        evq_is_empty() && gpio_get(ROT_SW) &&
+        to_ms_since_boot(get_absolute_time()) - idle_since_ms >= POWER_IDLE_MS) {
+        persist_flush();
+        log_flush();
+        // Replay the wake-up press so it is handled like any other button press
+        if (power_dormant(ROT_SW)) {
+            const uint32_t ints = save_and_disable_interrupts(); // Recognizer state belongs to the ISRs
+            gesture_button(true);
+            restore_interrupts(ints);
         }
+        // Clocks are back at POWER_RUN_KHZ, dividers must follow before the first light
+        set_pwm_clkdiv();
+        strip_set_clkdiv();
+        idle_since_ms = to_ms_since_boot(get_absolute_time());
+        return;
+    }
+
+    // Erase ahead for the flash log while the knob is still and the output steady. The erase
+    // holds off interrupts and the control tick, a fade or effect would visibly stall.
+    if (!anim_busy(&anim) && !dimmer.effect &&
+        to_ms_since_boot(get_absolute_time()) - idle_since_ms >= POWER_SCALE_IDLE_MS) {
+        persist_prepare();
+    }
 
-        sleep_ms(10); // 10 ms delay (0.01 second) to reduce CPU usage
+    // Nothing to do but wait for input, run on a slower clock until input_task() restores it.
+    // TOP is unchanged so duty cycles stay the same across the switch.
+    // The log must be idle so no character is sent across the baud rate change.
+    if (!DIMMER_WIFI && to_ms_since_boot(get_absolute_time()) - idle_since_ms >= POWER_SCALE_IDLE_MS &&
+        !run_clock_wanted && log_idle() && power_set_sys_khz(POWER_LOW_KHZ)) {
+        set_pwm_clkdiv();
+        strip_set_clkdiv();
     }
 }
+
+bool input_ready(void) {
+    return !evq_is_empty();
+}
+
 // Interrupt callback for pressing ROT_SW and rotary encoder
 void gpio_callback(uint const gpio, uint32_t const event_mask) {
-    // Button press/release with debounce to ensure one physical press counts as one event
+    // Button press/release with debounce to ensure one physical press counts as one event.
+    // Edges go to the gesture recognizer, which queues the button and gesture events.
     if (gpio == ROT_SW) {
         static uint32_t last_ms = 0; // Store last interrupt time
         const uint32_t now = to_ms_since_boot(get_absolute_time());
@@ -103,110 +249,78 @@ void gpio_callback(uint const gpio, uint32_t const event_mask) {
         // Detect button release (rising edge)
         if (event_mask & GPIO_IRQ_EDGE_RISE && now - last_ms >= DEBOUNCE_MS) {
             last_ms = now;
-            const event_t event = { .type = EVENT_BUTTON, .data = 0 };
-            queue_try_add(&events, &event); // Add event to queue
+            gesture_button(false);
         }
 
         // Detect button press (falling edge)
         if (event_mask & GPIO_IRQ_EDGE_FALL && now - last_ms >= DEBOUNCE_MS){
             last_ms = now;
-            const event_t event = { .type = EVENT_BUTTON, .data = 1 };
-            queue_try_add(&events, &event); // Add event to queue
+            gesture_button(true);
         }
+        // Behaviours waiting on the button read its state themselves
+        coro_signal(CORO_BUTTON);
     }
 
     // Rotary encoder rotation direction detection
     if (gpio == ROT_A && event_mask & GPIO_IRQ_EDGE_RISE) {
         const bool rot_b_state = gpio_get(ROT_B); // Read state of second encoder pin to determine rotation direction
-        const event_t event = { .type = EVENT_ENCODER, .data = rot_b_state ? -1 : +1 }; // Determine rotation direction
-        queue_try_add(&events, &event); // Add event to queue
+        const int32_t step = rot_b_state ? -1 : +1; // Determine rotation direction
+        // Turning with the button held is a fine adjustment gesture
+        if (!gesture_encoder(step)) {
+            const event_t event = { .type = EVENT_ENCODER, .data = step };
+            if (!evq_add(&event)) log_isr("encoder event dropped:", event.data); // Add event to queue
+        }
     }
 }
 
-void ini_rot(const uint *rots) {
+void ini_rot(void) {
     // Initialize rotary switch with internal pull-up
     gpio_init(ROT_SW);
     gpio_set_dir(ROT_SW, GPIO_IN);
     gpio_pull_up(ROT_SW);
 
     // Initialize rotary encoder pins A and B without pull-ups
-    for (int i = 0; i < 2; i++) {
-        gpio_init(rots[i]);
-        gpio_set_dir(rots[i], GPIO_IN);
-        gpio_disable_pulls(rots[i]);
-    }
+    gpio_init_mask(PIN_BIT(ROT_A) | PIN_BIT(ROT_B));
+    gpio_disable_pulls(ROT_A);
+    gpio_disable_pulls(ROT_B);
 
-    // Initialize event queue for Interrupt Service Routine (ISR)
-    // 32 chosen as a safe buffer size: large enough to handle bursts of interrupts
-    // without losing events, yet small enough to keep RAM usage minimal.
-    queue_init(&events, sizeof(event_t), 32);
+    // Initialize event queue for Interrupt Service Routine (ISR), see evq.h for sizing and overflow
+    ini_evq();
+    // Gesture timeouts run on a hardware alarm
+    ini_gesture();
 
     // Configure button interrupt and callback
     gpio_set_irq_enabled_with_callback(ROT_SW, GPIO_IRQ_EDGE_FALL |
         GPIO_IRQ_EDGE_RISE, true, &gpio_callback);
 
     // Enable rising edge interrupt for encoder A and B
-    for (int i = 0; i < 2; i++) {
-        gpio_set_irq_enabled(rots[i], GPIO_IRQ_EDGE_RISE, true);
-    }
+    gpio_set_irq_enabled(ROT_A, GPIO_IRQ_EDGE_RISE, true);
+    gpio_set_irq_enabled(ROT_B, GPIO_IRQ_EDGE_RISE, true);
 }
 
-void ini_leds(const uint *leds) {
-    // Track which PWM slices (0-7) have been initialized
-    bool slice_ini[8] = {false};
-
-    // Get default PWM configuration
-    pwm_config config = pwm_get_default_config();
-    // Set clock divider
-    pwm_config_set_clkdiv_int(&config, CLK_DIV);
-    // Set wrap (TOP)
-    pwm_config_set_wrap(&config, TOP);
-
-    // Configure PWM for each LED pin
-    for (int i = 0; i < LEDS_SIZE; i++) {
-        // Get PWM slice and channel for this GPIO pin
-        const uint slice = pwm_gpio_to_slice_num(leds[i]);
-        const uint chan = pwm_gpio_to_channel(leds[i]);
-
-        // Stop PWM
-        pwm_set_enabled(slice, false);
-
-        // Initialize each slice once
-        if (!slice_ini[slice]) {
-            pwm_init(slice, &config, false); // Start set to false
-            slice_ini[slice] = true;
-        }
-
-        // Set compare value (CC) to define duty cycle
-        pwm_set_chan_level(slice, chan, 0);
-        // Select PWM model for your pin
-        gpio_set_function(leds[i], GPIO_FUNC_PWM);
-        // Start PWM
-        pwm_set_enabled(slice, true);
-    }
+void output_levels(const anim_t *anim, uint32_t levels[LEDS_SIZE]) {
+    // The setpoint backs off with the ambient light
+    const q16_t level = q16_mul(anim->value[ANIM_LEVEL], sense_scale());
+    q16_t q[LEDS_SIZE];
+#if DIMMER_CCT
+    // Warm, neutral and cool emitters blended for the colour temperature
+    _Static_assert(CCT_EMITTERS == LEDS_SIZE, "one emitter per LED");
+    cct_mix(Q16_ROUND(level), Q16_ROUND(anim->value[ANIM_CCT]), q);
+#else
+    for (uint led = 0; led < LEDS_SIZE; led++) q[led] = level;
+#endif
+    // Thermal derating holds back every channel alike
+    const q16_t derate = sense_get_derate()->factor;
+    for (uint led = 0; led < LEDS_SIZE; led++) q[led] = q16_mul(q[led], derate);
+    // Clamp and gamma on the interpolators
+    pipeline_run(q, levels, LEDS_SIZE);
 }
 
-bool light_switch(const uint *leds, const uint brightness, const bool on) {
-    if (on) {
-        set_brightness(leds, brightness);
-        return true;
-    }
-    set_brightness(leds, 0);
-    return false;
+uint32_t strip_output_level(const anim_t *anim) {
+    // Same setpoint, ambient scaling and derating as the PWM LEDs; the strip mixes its own colours
+    q16_t q = q16_mul(q16_mul(anim->value[ANIM_LEVEL], sense_scale()), sense_get_derate()->factor);
+    // One channel through the interpolator clamp and gamma, the pixels are scaled with the result
+    uint32_t level;
+    pipeline_run(&q, &level, 1);
+    return level;
 }
-
-void set_brightness(const uint *leds, const uint brightness) {
-    // Update duty cycle for all LED channels
-    for (int i = 0; i < LEDS_SIZE; i++) {
-        const uint slice = pwm_gpio_to_slice_num(leds[i]);
-        const uint chan  = pwm_gpio_to_channel(leds[i]);
-        pwm_set_chan_level(slice, chan, brightness);
-    }
-}
-
-uint clamp(const int br) {
-    // Limit brightness value to valid PWM range [0, TOP]
-    if (br < 0) return 0; // Lower bound
-    if (br > MAX_BR) return MAX_BR; // Upper bound
-    return br; // Within range
-}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "net.h"
+
+#define HEADER_SIZE 4
+#define ENTRY_SIZE 4
+
+// Scene presets, a scene fades to its level
+typedef struct {
+    uint16_t level;
+    uint16_t fade_ms;
+} net_scene_t;
+
+static const net_scene_t scenes[NET_SCENES] = {
+    { 0, 1000 }, // Off
+    { MAX_BR / 4, 500 }, // Dim
+    { BR_MID, 500 }, // Half
+    { MAX_BR, 300 } // Full
+};
+
+static const net_transport_t *net_transport;
+static net_post_fn net_post;
+static net_stats_t stats;
+
+bool ini_net(const net_transport_t *transport, const net_post_fn post) {
+    net_transport = transport;
+    net_post = post;
+    return transport->start(NET_PORT);
+}
+
+void net_poll(void) {
+    if (net_transport) net_transport->poll();
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+// Turn one entry into an event; returns false for unknown operations
+static bool entry_event(const uint8_t op, const uint16_t value, event_t *event) {
+    switch (op) {
+        case NET_OP_LEVEL:
+            *event = (event_t){ .type = EVENT_SET_LEVEL, .data = clamp(value) };
+            return true;
+        case NET_OP_POWER:
+            *event = (event_t){ .type = EVENT_SET_POWER, .data = value != 0 };
+            return true;
+        case NET_OP_SCENE:
+            if (value >= NET_SCENES) return false;
+            *event = (event_t){ .type = EVENT_FADE, .data = FADE_DATA(scenes[value].level, scenes[value].fade_ms) };
+            return true;
+        default:
+            return false;
+    }
+}
+
+void net_handle_datagram(const uint8_t *data, const size_t len) {
+    // Entries are read where they lie in the receive buffer, nothing is copied or allocated
+    if (len < HEADER_SIZE || get_u16(data) != NET_MAGIC || len != HEADER_SIZE + (size_t)data[3] * ENTRY_SIZE) {
+        stats.bad_datagrams++;
+        return;
+    }
+    stats.datagrams++;
+
+    const uint8_t *entry = data + HEADER_SIZE;
+    for (unsigned i = 0; i < data[3]; i++, entry += ENTRY_SIZE) {
+        if (entry[0] != NET_CHANNEL && entry[0] != NET_CHANNEL_ALL) continue;
+
+        event_t event;
+        if (!entry_event(entry[1], get_u16(&entry[2]), &event)) continue;
+        stats.entries_applied++;
+        if (!net_post(&event)) stats.events_dropped++;
+    }
+}
+
+const net_stats_t *net_get_stats(void) {
+    return &stats;
+}
@@ -0,0 +1,58 @@
+#ifndef NET_H
+#define NET_H
+
+// UDP remote control. One datagram carries updates for many dimmers; each
+// board applies the entries addressed to its NET_CHANNEL:
+//   header [magic u16 'DM'][seq u8][count u8]
+//   count x [channel u8][op u8][value u16]
+// all little-endian. Datagram handling is free of Pico SDK dependencies and
+// the socket side sits behind net_transport_t, so the radio can be replaced
+// by any UDP implementation.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dimmer.h"
+
+#define NET_PORT 4210 // UDP port the dimmer listens on
+#ifndef NET_CHANNEL
+#define NET_CHANNEL 1 // Channel this board answers to
+#endif
+#define NET_CHANNEL_ALL 0xFF // Entry applies to every board
+#define NET_MAGIC 0x4D44 // 'D', 'M'
+#define NET_MAX_DATAGRAM 1024 // Longest datagram accepted, 255 entries fit
+#define NET_SCENES 4 // Number of preset scenes
+
+// Operation of one datagram entry
+typedef enum {
+    NET_OP_LEVEL = 1, // value: level, switches on
+    NET_OP_POWER = 2, // value: 1 = on, 0 = off
+    NET_OP_SCENE = 3 // value: scene index
+} net_op;
+
+// Socket side of the network layer
+typedef struct {
+    bool (*start)(uint16_t port); // Bind port and pass datagrams to net_handle_datagram()
+    void (*poll)(void); // Service the stack, called from the main loop
+} net_transport_t;
+
+typedef bool (*net_post_fn)(const event_t *event); // Queue an event, false if it was dropped
+
+// Datagram counters
+typedef struct {
+    uint32_t datagrams; // Well-formed datagrams
+    uint32_t bad_datagrams; // Wrong magic or length
+    uint32_t entries_applied; // Entries addressed to this board
+    uint32_t events_dropped; // Entries the event queue refused
+} net_stats_t;
+
+bool ini_net(const net_transport_t *transport, net_post_fn post); // Start listening on NET_PORT
+void net_poll(void);
+void net_handle_datagram(const uint8_t *data, size_t len); // Called by transports for each datagram
+const net_stats_t *net_get_stats(void);
+
+#if DIMMER_WIFI
+extern const net_transport_t net_lwip_transport; // CYW43 radio and lwIP, Pico W only
+#endif
+
+#endif
@@ -0,0 +1,55 @@
+#include "pico/cyw43_arch.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "net.h"
+
+#define RECONNECT_MS 10000 // Retry interval while the link is down
+
+static struct udp_pcb *pcb;
+static uint8_t chained[NET_MAX_DATAGRAM]; // Only used when a datagram spans several pbufs
+static uint32_t last_connect_ms;
+
+// Called from cyw43_arch_poll() in the main loop
+static void on_recv(void *arg, struct udp_pcb *upcb, struct pbuf *p, const ip_addr_t *addr, u16_t port) {
+    if (p->len == p->tot_len) {
+        // Single pbuf, parse straight from the receive buffer
+        net_handle_datagram(p->payload, p->len);
+    }
+    else if (p->tot_len <= sizeof(chained)) {
+        pbuf_copy_partial(p, chained, p->tot_len, 0);
+        net_handle_datagram(chained, p->tot_len);
+    }
+    pbuf_free(p);
+}
+
+static void wifi_connect(void) {
+    last_connect_ms = to_ms_since_boot(get_absolute_time());
+    cyw43_arch_wifi_connect_async(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK);
+}
+
+static bool lwip_start(const uint16_t port) {
+    if (cyw43_arch_init()) return false;
+    cyw43_arch_enable_sta_mode();
+    wifi_connect(); // Doesn't wait for the link, the main loop keeps running
+
+    pcb = udp_new();
+    if (!pcb || udp_bind(pcb, IP_ANY_TYPE, port) != ERR_OK) return false;
+    udp_recv(pcb, on_recv, NULL);
+    return true;
+}
+
+static void lwip_poll(void) {
+    cyw43_arch_poll();
+
+    // Rejoin after the access point dropped us or the first attempt failed
+    const int status = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+    if (status != CYW43_LINK_UP && status != CYW43_LINK_JOIN && status != CYW43_LINK_NOIP &&
+        to_ms_since_boot(get_absolute_time()) - last_connect_ms >= RECONNECT_MS) {
+        wifi_connect();
+    }
+}
+
+const net_transport_t net_lwip_transport = {
+    .start = lwip_start,
+    .poll = lwip_poll
+};
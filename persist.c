@@ -0,0 +1,209 @@
+#include <string.h>
+#include "persist.h"
+#include "tasks.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+
+#define PERSIST_BASE (PICO_FLASH_SIZE_BYTES - PERSIST_SECTORS * FLASH_SECTOR_SIZE) // Flash offset of the log
+#define RECORD_MAGIC 0xD1A5 // Slot holds a state record
+#define HEADER_MAGIC 0x5EC7 // Slot 0 of a sector, value is the sector generation
+#define FLAG_LIGHTS_ON 0x0001 // Record flag for dimmer_t.lights_on
+#define FLAG_CCT_SHIFT 8 // Record flags bits 8..15 hold dimmer_t.cct
+
+// One 8-byte slot of the log. Erased flash reads back as all ones, so only a
+// slot with a valid magic and check word was programmed completely.
+typedef struct {
+    uint16_t magic; // RECORD_MAGIC or HEADER_MAGIC
+    uint16_t value; // Brightness, or generation for a header
+    uint16_t flags; // FLAG_LIGHTS_ON, colour temperature from FLAG_CCT_SHIFT
+    uint16_t check; // Inverted xor of the other fields
+} persist_record_t;
+
+#define SLOTS_PER_SECTOR (FLASH_SECTOR_SIZE / sizeof(persist_record_t))
+
+static persist_stats_t stats;
+static uint active_sector; // Sector new records are appended to
+static uint next_slot = SLOTS_PER_SECTOR; // First erased slot, a full sector forces a rotation
+static uint16_t generation; // Generation of the active sector, newer sectors have higher values
+static persist_record_t written; // Last record in flash
+static persist_record_t pending; // Record waiting for PERSIST_DELAY_MS of stillness
+static bool has_pending;
+static bool spare_erased; // The sector after the active one is blank, rotate_sector() only programs
+static uint32_t pending_since_ms;
+
+static persist_record_t make_record(const uint16_t magic, const uint16_t value, const uint16_t flags) {
+    const persist_record_t rec = {
+        .magic = magic, .value = value, .flags = flags,
+        .check = (uint16_t)~(magic ^ value ^ flags)
+    };
+    return rec;
+}
+
+static bool record_valid(const persist_record_t *rec, const uint16_t magic) {
+    return rec->magic == magic && rec->check == (uint16_t)~(rec->magic ^ rec->value ^ rec->flags);
+}
+
+static bool record_erased(const persist_record_t *rec) {
+    return rec->magic == 0xFFFF && rec->value == 0xFFFF && rec->flags == 0xFFFF && rec->check == 0xFFFF;
+}
+
+static const persist_record_t *slot_ptr(const uint sector, const uint slot) {
+    return (const persist_record_t *)(XIP_BASE + PERSIST_BASE + sector * FLASH_SECTOR_SIZE +
+                                      slot * sizeof(persist_record_t));
+}
+
+#if DIMMER_FREERTOS
+#include "pico/flash.h"
+#endif
+
+// Run a flash erase or program with nothing executing from flash. FreeRTOS
+// builds run tasks on the other core too, flash_safe_execute() parks it first.
+// PWM keeps running in hardware; GPIO edges stay latched until interrupts are back.
+// A page program is over in about a millisecond, a sector erase takes tens of
+// milliseconds (a few hundred at worst): encoder edges in that time merge into
+// one latched edge and gesture timeouts fire late, hence persist_prepare().
+static void flash_op(void (*op)(void *), void *param) {
+#if DIMMER_FREERTOS
+    flash_safe_execute(op, param, UINT32_MAX);
+#else
+    const uint32_t ints = save_and_disable_interrupts();
+    op(param);
+    restore_interrupts(ints);
+#endif
+}
+
+static void program_page(void *param) {
+    const uint32_t *args = param; // Flash offset, page buffer
+    flash_range_program(args[0], (const uint8_t *)(uintptr_t)args[1], FLASH_PAGE_SIZE);
+}
+
+static void erase_sector(void *param) {
+    flash_range_erase(*(const uint32_t *)param, FLASH_SECTOR_SIZE);
+}
+
+// Program one slot. Bits of the rest of the page are left at one, so slots
+// already written in the same page keep their contents.
+static void program_slot(const uint sector, const uint slot, const persist_record_t *rec) {
+    static uint8_t page[FLASH_PAGE_SIZE];
+    const uint32_t offset = slot * sizeof(persist_record_t);
+
+    memset(page, 0xFF, sizeof(page));
+    memcpy(&page[offset % FLASH_PAGE_SIZE], rec, sizeof(*rec));
+
+    // Code running from flash can't be executed while it is being written
+    uint32_t args[] = { PERSIST_BASE + sector * FLASH_SECTOR_SIZE + offset - offset % FLASH_PAGE_SIZE, (uintptr_t)page };
+    flash_op(program_page, args);
+}
+
+// Sector the log moves to when the active one is full
+static uint spare_sector(void) {
+    return (active_sector + 1) % PERSIST_SECTORS;
+}
+
+static void erase(const uint sector) {
+    uint32_t base = PERSIST_BASE + sector * FLASH_SECTOR_SIZE;
+    flash_op(erase_sector, &base);
+    stats.sectors_erased++;
+}
+
+// Start the next sector of the log with rec once the active one is full.
+// rec is programmed before the header: persist_load() ignores a sector
+// without a header and keeps reading the old one, so power lost anywhere in
+// between never leaves a newest sector that holds no record.
+static void rotate_sector(const persist_record_t *rec) {
+    const uint sector = spare_sector();
+
+    // Normally done ahead by persist_prepare(), erasing here stalls the caller
+    if (!spare_erased) erase(sector);
+    program_slot(sector, 1, rec);
+
+    generation++;
+    const persist_record_t header = make_record(HEADER_MAGIC, generation, 0);
+    program_slot(sector, 0, &header);
+    active_sector = sector;
+    next_slot = 2;
+    spare_erased = false; // The old sector is the spare now
+}
+
+bool persist_load(dimmer_t *d) {
+    // Newest sector is the valid header with the highest generation (wrap-aware)
+    bool found = false;
+    for (uint s = 0; s < PERSIST_SECTORS; s++) {
+        const persist_record_t *header = slot_ptr(s, 0);
+        if (!record_valid(header, HEADER_MAGIC)) continue;
+        if (!found || (int16_t)(header->value - generation) > 0) {
+            active_sector = s;
+            generation = header->value;
+            found = true;
+        }
+    }
+    if (!found) return false;
+
+    // Last valid record wins; slots with a torn write are skipped
+    bool restored = false;
+    next_slot = SLOTS_PER_SECTOR;
+    for (uint slot = 1; slot < SLOTS_PER_SECTOR; slot++) {
+        const persist_record_t *rec = slot_ptr(active_sector, slot);
+        if (record_erased(rec)) {
+            next_slot = slot;
+            break;
+        }
+        if (record_valid(rec, RECORD_MAGIC) && rec->value <= MAX_BR) {
+            written = *rec;
+            restored = true;
+        }
+    }
+    if (!restored) return false;
+
+    d->brightness = written.value;
+    d->lights_on = written.flags & FLAG_LIGHTS_ON;
+    const uint cct = written.flags >> FLAG_CCT_SHIFT;
+    if (cct <= CCT_MAX) d->cct = cct;
+    return true;
+}
+
+void persist_save_later(const dimmer_t *d) {
+    const persist_record_t rec = make_record(RECORD_MAGIC, (uint16_t)d->brightness,
+                                             (uint16_t)((d->lights_on ? FLAG_LIGHTS_ON : 0) | d->cct << FLAG_CCT_SHIFT));
+
+    // Turned back to what flash already holds, nothing left to write
+    if (memcmp(&rec, &written, sizeof(rec)) == 0) {
+        if (has_pending) stats.saves_coalesced++;
+        has_pending = false;
+        return;
+    }
+    if (has_pending) stats.saves_coalesced++;
+    pending = rec;
+    has_pending = true;
+    pending_since_ms = to_ms_since_boot(get_absolute_time());
+}
+
+void persist_poll(void) {
+    if (has_pending && to_ms_since_boot(get_absolute_time()) - pending_since_ms >= PERSIST_DELAY_MS) {
+        persist_flush();
+    }
+}
+
+void persist_prepare(void) {
+    if (spare_erased) return;
+    // Skip the erase if the sector is blank already, on new flash or after a reboot
+    const uint sector = spare_sector();
+    bool blank = true;
+    for (uint slot = 0; slot < SLOTS_PER_SECTOR && blank; slot++) blank = record_erased(slot_ptr(sector, slot));
+    if (!blank) erase(sector);
+    spare_erased = true;
+}
+
+void persist_flush(void) {
+    if (!has_pending) return;
+    has_pending = false;
+
+    if (next_slot >= SLOTS_PER_SECTOR) rotate_sector(&pending);
+    else program_slot(active_sector, next_slot++, &pending);
+    written = pending;
+    stats.records_written++;
+}
+
+const persist_stats_t *persist_get_stats(void) {
+    return &stats;
+}
@@ -0,0 +1,30 @@
+#ifndef PERSIST_H
+#define PERSIST_H
+
+// Brightness, on/off state and colour temperature kept across power loss in the last flash sectors.
+// Sectors are used as an append-only log of small records; a sector is erased
+// only when the other one fills up, spreading wear over every record slot.
+
+#include "pico/stdlib.h"
+#include "dimmer.h"
+
+#define PERSIST_SECTORS 2 // Flash sectors used for the log, at the end of flash
+#define PERSIST_DELAY_MS 2000 // State must be still this long before it is written
+
+// Flash wear statistics
+typedef struct {
+    uint32_t records_written; // Records appended since boot
+    uint32_t sectors_erased; // Sector erases since boot
+    uint32_t saves_coalesced; // Changes that were merged into a later write
+} persist_stats_t;
+
+bool persist_load(dimmer_t *d); // Restore the last saved state, false if flash holds none
+void persist_save_later(const dimmer_t *d); // Schedule a write, restarts the PERSIST_DELAY_MS delay
+void persist_poll(void); // Write the scheduled state once its delay has passed
+void persist_flush(void); // Write the scheduled state now
+// Erase the sector the log moves to next, so no write has to. Call while
+// the knob is idle, the erase holds interrupts off for tens of milliseconds.
+void persist_prepare(void);
+const persist_stats_t *persist_get_stats(void);
+
+#endif
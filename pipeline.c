@@ -0,0 +1,85 @@
+#include "pipeline.h"
+#include "dimmer.h"
+#include "logger.h"
+#include "hardware/interp.h"
+
+#define ROUND_Q16 0x8000 // Added before truncating to the table index
+#define MAX_Q16 Q16(MAX_BR)
+
+_Static_assert(MAX_BR < 1024, "table index must fit the INTERP0 mask");
+
+// Compare value for each level. CIE 1931 lightness L = 100 * level / MAX_BR gives
+// luminance Y = ((L + 16) / 116)^3 above L = 8 and L / 903.3 below.
+#define L(i) (100.0 * (i) / MAX_BR)
+#define CIE(i) (L(i) > 8.0 ? ((L(i) + 16.0) / 116.0) * ((L(i) + 16.0) / 116.0) * ((L(i) + 16.0) / 116.0) \
+                           : L(i) / 903.3)
+#if LED_GAMMA
+#define ENTRY(i) (uint16_t)(CIE(i) * MAX_BR + 0.5),
+#else
+#define ENTRY(i) (uint16_t)(i),
+#endif
+#define ENTRIES4(i) ENTRY(i) ENTRY(i + 1) ENTRY(i + 2) ENTRY(i + 3)
+#define ENTRIES16(i) ENTRIES4(i) ENTRIES4(i + 4) ENTRIES4(i + 8) ENTRIES4(i + 12)
+#define ENTRIES64(i) ENTRIES16(i) ENTRIES16(i + 16) ENTRIES16(i + 32) ENTRIES16(i + 48)
+#define ENTRIES256(i) ENTRIES64(i) ENTRIES64(i + 64) ENTRIES64(i + 128) ENTRIES64(i + 192)
+
+// 1024 entries, the ones past MAX_BR are never indexed after the clamp
+static const uint16_t gamma_table[1024] = {
+    ENTRIES256(0) ENTRIES256(256) ENTRIES256(512) ENTRIES256(768)
+};
+
+void ini_pipeline(void) {
+    // INTERP1 lane 0: signed clamp of the whole accumulator to [BASE0, BASE1]
+    interp_config clamp = interp_default_config();
+    interp_config_set_clamp(&clamp, true);
+    interp_config_set_signed(&clamp, true);
+    interp_set_config(interp1, 0, &clamp);
+    interp1->base[0] = 0;
+    interp1->base[1] = MAX_Q16;
+
+    // INTERP0 lane 0: BASE0 + ((accum >> 15) & 0x7FE) is the address of gamma_table[accum >> 16]
+    interp_config index = interp_default_config();
+    interp_config_set_shift(&index, 15);
+    interp_config_set_mask(&index, 1, 10);
+    interp_set_config(interp0, 0, &index);
+    interp0->base[0] = (uintptr_t)gamma_table;
+}
+
+void pipeline_run(const q16_t *in, uint32_t *out, const uint n) {
+    for (uint i = 0; i < n; i++) {
+        interp1->accum[0] = in[i] + ROUND_Q16;
+        interp0->accum[0] = interp1->peek[0];
+        out[i] = *(const uint16_t *)(uintptr_t)interp0->peek[0];
+    }
+}
+
+void pipeline_run_c(const q16_t *in, uint32_t *out, const uint n) {
+    for (uint i = 0; i < n; i++) {
+        const int32_t v = (int32_t)(in[i] + ROUND_Q16);
+        const uint32_t clamped = v < 0 ? 0 : v > (int32_t)MAX_Q16 ? MAX_Q16 : (uint32_t)v;
+        out[i] = gamma_table[clamped >> 16];
+    }
+}
+
+void pipeline_bench(void) {
+    enum { CHANNELS = 64, RUNS = 1000 };
+    static q16_t in[CHANNELS];
+    static uint32_t out_interp[CHANNELS];
+    static uint32_t out_c[CHANNELS];
+    // Levels across and beyond the valid range, both clamp bounds are hit
+    for (uint i = 0; i < CHANNELS; i++) in[i] = (q16_t)(((int32_t)(i * (MAX_BR + 200) / CHANNELS) - 100) * 65536);
+
+    uint32_t start = time_us_32();
+    for (uint r = 0; r < RUNS; r++) pipeline_run(in, out_interp, CHANNELS);
+    const uint32_t interp_us = time_us_32() - start;
+    start = time_us_32();
+    for (uint r = 0; r < RUNS; r++) pipeline_run_c(in, out_c, CHANNELS);
+    const uint32_t c_us = time_us_32() - start;
+
+    bool same = true;
+    for (uint i = 0; i < CHANNELS; i++) same = same && out_interp[i] == out_c[i];
+    // ns per channel at the current clk_sys
+    log_printf("pipeline: interp %u ns, C %u ns per channel, results %s\n",
+               (uint)(interp_us * 1000u / (RUNS * CHANNELS)), (uint)(c_us * 1000u / (RUNS * CHANNELS)),
+               same ? "match" : "differ");
+}
@@ -0,0 +1,26 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+// Output pipeline from Q16 channel levels to PWM compare values:
+// round, clamp to [0, MAX_BR], then look the level up in a gamma table.
+// The clamp runs on INTERP1 (the only interpolator with a clamp mode) and
+// INTERP0 turns the clamped level into the table entry address, so a channel
+// costs a few single-cycle SIO accesses and one load. The interpolators of
+// the core running the main loop are used, interrupt handlers must not touch them.
+
+#include "pico/stdlib.h"
+#include "fixed.h"
+
+#ifndef LED_GAMMA
+#define LED_GAMMA 0 // 0: table is linear, level is duty; 1: CIE 1931 lightness, even steps for the eye
+#endif
+#ifndef PIPELINE_BENCH
+#define PIPELINE_BENCH 0 // Log interpolator and plain C timings at boot
+#endif
+
+void ini_pipeline(void); // Configure INTERP0 and INTERP1 lane 0
+void pipeline_run(const q16_t *in, uint32_t *out, uint n); // Compare values for n channels
+void pipeline_run_c(const q16_t *in, uint32_t *out, uint n); // Same result without the interpolators
+void pipeline_bench(void); // Time both versions and log the result
+
+#endif
@@ -0,0 +1,110 @@
+#include <assert.h>
+#include "power.h"
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "hardware/pll.h"
+#include "hardware/uart.h"
+#include "hardware/xosc.h"
+
+static power_stats_t stats;
+static uint32_t wake_us; // Timestamp right after the crystal restarted
+static bool wake_pending; // Set until the first light after a wake is recorded
+static uint32_t extra_wake_pins; // Bit mask of pins added by power_add_wake_pin()
+static power_clock_fn clock_hooks[POWER_CLOCK_HOOKS];
+static uint clock_hook_count;
+
+// Switch every clock to the crystal so the PLLs can be stopped
+static void run_from_xosc(void) {
+    clock_configure(clk_ref, CLOCKS_CLK_REF_CTRL_SRC_VALUE_XOSC_CLKSRC, 0,
+                    POWER_XOSC_HZ, POWER_XOSC_HZ);
+    clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLK_REF, 0,
+                    POWER_XOSC_HZ, POWER_XOSC_HZ);
+    clock_configure(clk_peri, 0, CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS,
+                    POWER_XOSC_HZ, POWER_XOSC_HZ);
+    clock_stop(clk_usb);
+    clock_stop(clk_adc);
+    pll_deinit(pll_sys);
+    pll_deinit(pll_usb);
+}
+
+// Keep the stdio UART at its baud rate after clk_peri changed, then let the
+// other peripherals on clk_peri do the same
+static void restore_uart_baud(void) {
+    uart_set_baudrate(uart_default, PICO_DEFAULT_UART_BAUD_RATE);
+    for (uint i = 0; i < clock_hook_count; i++) clock_hooks[i]();
+}
+
+bool power_set_sys_khz(const uint32_t khz) {
+    if (clock_get_hz(clk_sys) == khz * KHZ) return false;
+
+    uart_default_tx_wait_blocking();
+    if (khz * KHZ == POWER_XOSC_HZ) {
+        // Too slow for the PLL, run clk_sys straight from the crystal
+        clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX,
+                        CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_XOSC_CLKSRC, POWER_XOSC_HZ, POWER_XOSC_HZ);
+        clock_configure(clk_peri, 0, CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS,
+                        POWER_XOSC_HZ, POWER_XOSC_HZ);
+    }
+    else {
+        // Reprograms pll_sys and moves clk_peri along with clk_sys
+        set_sys_clock_khz(khz, true);
+    }
+    restore_uart_baud();
+    stats.clock_switches++;
+    return true;
+}
+
+void power_add_wake_pin(const uint pin) {
+    extra_wake_pins |= 1u << pin;
+}
+
+void power_add_clock_hook(const power_clock_fn fn) {
+    assert(clock_hook_count < POWER_CLOCK_HOOKS);
+    clock_hooks[clock_hook_count++] = fn;
+}
+
+// Enable or disable the falling edge dormant wake on the button and every extra pin
+static void set_wake_pins(const uint wake_pin, const bool enabled) {
+    const uint32_t pins = extra_wake_pins | 1u << wake_pin;
+    for (uint pin = 0; pin < 32; pin++) {
+        if (!(pins & 1u << pin)) continue;
+        gpio_set_dormant_irq_enabled(pin, GPIO_IRQ_EDGE_FALL, enabled);
+        // Drop the latched wake edge so the GPIO callback doesn't report it as well
+        if (!enabled) gpio_acknowledge_irq(pin, GPIO_IRQ_EDGE_FALL);
+    }
+}
+
+bool power_dormant(const uint wake_pin) {
+    // Let pending UART output finish before its clock goes away
+    uart_default_tx_wait_blocking();
+
+    run_from_xosc();
+
+    // Only a button press (or an extra wake pin) wakes the board, encoder turns are ignored while off
+    set_wake_pins(wake_pin, true);
+    stats.dormant_entries++;
+    xosc_dormant(); // Returns once the wake edge restarted the crystal
+    wake_us = time_us_32();
+    wake_pending = true;
+    set_wake_pins(wake_pin, false);
+
+    // Bring PLLs and clk_sys/clk_peri back to their boot configuration.
+    // PWM registers keep their values while dormant, so only the clocks need restoring.
+    clocks_init();
+    if (POWER_RUN_KHZ != clock_get_hz(clk_sys) / KHZ) set_sys_clock_khz(POWER_RUN_KHZ, true);
+    restore_uart_baud();
+
+    return !gpio_get(wake_pin);
+}
+
+bool power_mark_first_light(void) {
+    if (!wake_pending) return false;
+    wake_pending = false;
+    stats.last_wake_us = time_us_32() - wake_us;
+    if (stats.last_wake_us > stats.max_wake_us) stats.max_wake_us = stats.last_wake_us;
+    return true;
+}
+
+const power_stats_t *power_get_stats(void) {
+    return &stats;
+}
@@ -0,0 +1,40 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include "pico/stdlib.h"
+
+#define POWER_IDLE_MS 1000 // Lights must stay off this long before going dormant
+#define POWER_XOSC_HZ (12 * MHZ) // Crystal oscillator frequency on Pico W
+#define POWER_RUN_KHZ 125000 // clk_sys at boot and after a wake-up
+#define POWER_LOW_KHZ 48000 // clk_sys while idle until the next input, 12000 runs straight from the crystal
+#define POWER_SCALE_IDLE_MS 200 // Time without events before dropping to POWER_LOW_KHZ
+
+// Wake statistics, updated by power_dormant() and power_mark_first_light()
+typedef struct {
+    uint32_t dormant_entries; // Number of times the board went dormant
+    uint32_t last_wake_us; // Wake to first light of the latest wake-up
+    uint32_t max_wake_us; // Worst wake to first light seen since boot
+    uint32_t clock_switches; // Number of clk_sys frequency changes
+} power_stats_t;
+
+#define POWER_CLOCK_HOOKS 4 // Most functions power_add_clock_hook() takes
+
+typedef void (*power_clock_fn)(void); // Reprograms something derived from clk_peri
+
+// Changes clk_sys and clk_peri to khz, reprograms the stdio UART baud rate
+// and runs the clock hooks. Callers must reprogram anything else derived from
+// clk_sys (the PWM dividers).
+// Returns false if khz was already the current frequency.
+bool power_set_sys_khz(uint32_t khz);
+
+void power_add_wake_pin(uint pin); // A falling edge on pin also ends dormant
+void power_add_clock_hook(power_clock_fn fn); // fn runs after every clk_peri change, dormant wake included
+
+// Stops all clocks until wake_pin sees a falling edge, then restores clk_sys
+// to POWER_RUN_KHZ.
+// Returns true if the pin was still low on wake (a button press to replay).
+bool power_dormant(uint wake_pin);
+bool power_mark_first_light(void); // Returns true if this was the first LED update after a wake
+const power_stats_t *power_get_stats(void);
+
+#endif
@@ -0,0 +1,117 @@
+#include "proto.h"
+
+#define AT(v, i) ((v)->buf[((v)->start + (i)) & (v)->mask]) // Byte i of a frame view
+
+uint16_t proto_crc16(uint16_t crc, const uint8_t byte) {
+    crc ^= (uint16_t)byte << 8;
+    for (int i = 0; i < 8; i++) {
+        crc = crc & 0x8000 ? (uint16_t)(crc << 1) ^ 0x1021 : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+// Argument bytes each command carries, -1 for unknown commands
+static int arg_len(const uint8_t cmd) {
+    switch (cmd) {
+        case PROTO_SET_LEVEL: return 2;
+        case PROTO_FADE: return 4;
+        case PROTO_QUERY: return 0;
+        case PROTO_STATS: return 0;
+        case PROTO_SET_POWER: return 1;
+        case PROTO_SET_CLOCK: return 4;
+        default: return -1;
+    }
+}
+
+bool proto_decode(proto_view_t *v, proto_cmd_t *cmd, proto_status *status) {
+    // COBS decode in place, every decoded byte lands at or before the byte it came from
+    uint32_t in = 0;
+    uint32_t out = 0;
+    while (in < v->len) {
+        const uint8_t code = AT(v, in);
+        in++;
+        if (code == 0 || in + code - 1 > v->len) return false;
+        for (uint8_t i = 1; i < code; i++) {
+            AT(v, out) = AT(v, in);
+            out++;
+            in++;
+        }
+        if (code < 0xFF && in < v->len) {
+            AT(v, out) = 0;
+            out++;
+        }
+    }
+    v->len = out;
+
+    // cmd, seq and CRC at least
+    if (v->len < 4 || v->len > PROTO_MAX_FRAME) return false;
+
+    uint16_t crc = 0xFFFF;
+    for (uint32_t i = 0; i < v->len - 2; i++) {
+        crc = proto_crc16(crc, AT(v, i));
+    }
+    if (crc != (uint16_t)(AT(v, v->len - 2) | AT(v, v->len - 1) << 8)) return false;
+
+    cmd->cmd = AT(v, 0);
+    cmd->seq = AT(v, 1);
+    cmd->arg0 = 0;
+    cmd->arg1 = 0;
+
+    const int args = arg_len(cmd->cmd);
+    if (args < 0) {
+        *status = PROTO_ERR_COMMAND;
+        return true;
+    }
+    if ((uint32_t)args != v->len - 4) {
+        *status = PROTO_ERR_LENGTH;
+        return true;
+    }
+    // Arguments are little-endian u16, a single byte argument lands in arg0
+    if (args == 1) cmd->arg0 = AT(v, 2);
+    if (args >= 2) cmd->arg0 = (uint16_t)(AT(v, 2) | AT(v, 3) << 8);
+    if (args >= 4) cmd->arg1 = (uint16_t)(AT(v, 4) | AT(v, 5) << 8);
+    *status = PROTO_OK;
+    return true;
+}
+
+size_t proto_encode_reply(const uint8_t cmd, const uint8_t seq, const proto_status status,
+                          const uint8_t *data, const size_t len, uint8_t *out, const size_t out_size) {
+    uint8_t raw[PROTO_MAX_FRAME];
+    const size_t raw_len = len + 5;
+    // Worst case COBS adds one byte per 254 plus the first code, then the two delimiters
+    if (raw_len > sizeof(raw) || out_size < raw_len + raw_len / 254 + 3) return 0;
+
+    raw[0] = cmd | PROTO_REPLY;
+    raw[1] = seq;
+    raw[2] = (uint8_t)status;
+    for (size_t i = 0; i < len; i++) raw[3 + i] = data[i];
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len + 3; i++) crc = proto_crc16(crc, raw[i]);
+    raw[len + 3] = crc & 0xFF;
+    raw[len + 4] = crc >> 8;
+
+    // Ends whatever came before on the same line
+    out[0] = 0;
+
+    // COBS encode, code_pos holds the place of the pending code byte
+    size_t code_pos = 1;
+    size_t o = 2;
+    uint8_t code = 1;
+    for (size_t i = 0; i < raw_len; i++) {
+        if (raw[i] == 0) {
+            out[code_pos] = code;
+            code_pos = o++;
+            code = 1;
+            continue;
+        }
+        out[o++] = raw[i];
+        if (++code == 0xFF) {
+            out[code_pos] = code;
+            code_pos = o++;
+            code = 1;
+        }
+    }
+    out[code_pos] = code;
+    out[o++] = 0; // Frame delimiter
+    return o;
+}
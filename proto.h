@@ -0,0 +1,67 @@
+#ifndef PROTO_H
+#define PROTO_H
+
+// Binary control protocol. Frames are COBS encoded and end with a 0x00
+// delimiter. Replies share the UART with log text, so they also start with
+// one: text logged since the last reply arrives as a frame of its own that
+// fails its CRC, instead of running into the reply. A decoded frame is
+//   [cmd][seq][args...][crc16 lo][crc16 hi]
+// with CRC-16/CCITT-FALSE over cmd, seq and args. Replies use cmd | PROTO_REPLY
+//   [cmd | PROTO_REPLY][seq][status][data...][crc16 lo][crc16 hi]
+// Free of Pico SDK dependencies so a host controller can link the same code.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PROTO_REPLY 0x80 // Set in the cmd byte of a reply
+#define PROTO_MAX_FRAME 64 // Longest decoded frame, longer ones are rejected
+#define PROTO_MAX_REPLY (PROTO_MAX_FRAME + PROTO_MAX_FRAME / 254 + 3) // Longest encoded reply with both delimiters
+
+// Commands sent by the controller
+typedef enum {
+    PROTO_SET_LEVEL = 0x01, // args: level u16, reply: none
+    PROTO_FADE = 0x02, // args: level u16, duration ms u16, reply: none
+    PROTO_QUERY = 0x03, // reply: level u16, brightness u16, lights on u8
+    PROTO_STATS = 0x04, // reply: u32 counters, see remote.c
+    PROTO_SET_POWER = 0x05, // args: on u8, reply: none
+    PROTO_SET_CLOCK = 0x06 // args: minute of day u16, second u16, reply: none
+} proto_cmd_type;
+
+// Reply status codes
+typedef enum {
+    PROTO_OK = 0,
+    PROTO_ERR_COMMAND = 1, // Unknown command
+    PROTO_ERR_LENGTH = 2, // Arguments don't match the command
+    PROTO_ERR_BUSY = 3, // Command couldn't be queued
+    PROTO_ERR_RANGE = 4 // Argument out of range
+} proto_status;
+
+// Bytes of a frame inside a ring buffer. mask is the ring size minus one;
+// a linear buffer uses UINT32_MAX.
+typedef struct {
+    uint8_t *buf;
+    uint32_t mask;
+    uint32_t start; // Index of the first byte
+    uint32_t len; // Bytes up to, not including, the 0x00 delimiter
+} proto_view_t;
+
+// Decoded command, arguments are read from the view and not copied
+typedef struct {
+    uint8_t cmd; // proto_cmd_type
+    uint8_t seq; // Echoed in the reply
+    uint16_t arg0; // level / on flag / minute of day
+    uint16_t arg1; // fade duration / second
+} proto_cmd_t;
+
+// Decode the COBS frame in place and check length and CRC.
+// Returns false for malformed frames; status tells unknown commands and bad arguments apart.
+bool proto_decode(proto_view_t *view, proto_cmd_t *cmd, proto_status *status);
+
+// COBS encode a reply with CRC between two delimiters into out. Returns the encoded length, 0 if out is too small.
+size_t proto_encode_reply(uint8_t cmd, uint8_t seq, proto_status status,
+                          const uint8_t *data, size_t len, uint8_t *out, size_t out_size);
+
+uint16_t proto_crc16(uint16_t crc, uint8_t byte); // CRC-16/CCITT-FALSE update, start with 0xFFFF
+
+#endif
@@ -0,0 +1,151 @@
+#include "remote.h"
+#include "proto.h"
+#include "evq.h"
+#include "logger.h"
+#include "persist.h"
+#include "power.h"
+#include "sense.h"
+#include "schedule.h"
+#include "hardware/dma.h"
+#include "hardware/uart.h"
+
+#define RX_MASK (REMOTE_RX_SIZE - 1)
+#define MAX_ENCODED (PROTO_MAX_FRAME + PROTO_MAX_FRAME / 254 + 1) // Longest COBS frame without its delimiter
+
+// Received bytes. DMA writes wrap back to rx_ring[0] only if rx_ring starts on a REMOTE_RX_SIZE boundary
+static uint8_t rx_ring[REMOTE_RX_SIZE] __attribute__((aligned(REMOTE_RX_SIZE)));
+static uint32_t received; // Free-running count of bytes written by DMA
+static uint32_t scanned; // Free-running index of the next byte to look at
+static uint32_t frame_start; // Free-running index of the first byte of the current frame
+
+static int dma_chan = -1;
+static remote_stats_t stats;
+
+void ini_remote(void) {
+    dma_chan = dma_claim_unused_channel(true);
+
+    dma_channel_config config = dma_channel_get_default_config(dma_chan);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_ring(&config, true, REMOTE_RX_BITS); // Wrap writes around the ring
+    channel_config_set_dreq(&config, uart_get_dreq(uart_default, false));
+    dma_channel_configure(dma_chan, &config, rx_ring, &uart_get_hw(uart_default)->dr, UINT32_MAX, true);
+
+    // A controller can wake the board, the first frame is lost while the crystal starts
+    power_add_wake_pin(PICO_DEFAULT_UART_RX_PIN);
+}
+
+static void put_u16(uint8_t *p, const uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+static void put_u32(uint8_t *p, const uint32_t v) {
+    put_u16(p, v);
+    put_u16(p + 2, v >> 16);
+}
+
+static void reply(const proto_cmd_t *cmd, const proto_status status, const uint8_t *data, const size_t len) {
+    uint8_t out[PROTO_MAX_REPLY];
+    const size_t n = proto_encode_reply(cmd->cmd, cmd->seq, status, data, len, out, sizeof(out));
+    if (n) log_write(out, n);
+}
+
+// Queue a command as an event, the same path encoder input takes
+static proto_status post(const event_type type, const int32_t data) {
+    const event_t event = { .type = type, .data = data };
+    return evq_add(&event) ? PROTO_OK : PROTO_ERR_BUSY;
+}
+
+static void execute(const proto_cmd_t *cmd, const dimmer_t *d) {
+    uint8_t data[PROTO_MAX_FRAME - 5]; // Room left after the reply header and CRC
+
+    switch (cmd->cmd) {
+        case PROTO_SET_LEVEL:
+            reply(cmd, post(EVENT_SET_LEVEL, clamp(cmd->arg0)), NULL, 0);
+            break;
+        case PROTO_FADE:
+            reply(cmd, post(EVENT_FADE, FADE_DATA(clamp(cmd->arg0), cmd->arg1)), NULL, 0);
+            break;
+        case PROTO_SET_POWER:
+            reply(cmd, post(EVENT_SET_POWER, cmd->arg0 != 0), NULL, 0);
+            break;
+        case PROTO_SET_CLOCK:
+            if (cmd->arg0 >= SCHEDULE_DAY_S / 60 || cmd->arg1 >= 60) {
+                reply(cmd, PROTO_ERR_RANGE, NULL, 0);
+                break;
+            }
+            schedule_set_clock(cmd->arg0 * 60u + cmd->arg1);
+            reply(cmd, PROTO_OK, NULL, 0);
+            break;
+        case PROTO_QUERY:
+            put_u16(&data[0], dimmer_level(d));
+            put_u16(&data[2], d->brightness);
+            data[4] = d->lights_on;
+            reply(cmd, PROTO_OK, data, 5);
+            break;
+        case PROTO_STATS: {
+            const uint32_t counters[] = {
+                stats.frames_ok, stats.frames_bad, stats.overruns,
+                log_get_stats()->dropped, log_get_stats()->isr_dropped,
+                persist_get_stats()->records_written, persist_get_stats()->sectors_erased,
+                power_get_stats()->dormant_entries, power_get_stats()->max_wake_us,
+                power_get_stats()->clock_switches,
+                evq_get_stats()->dropped_total, evq_get_stats()->merged, evq_get_stats()->high_water,
+                sense_get_derate()->factor
+            };
+            _Static_assert(sizeof(counters) <= sizeof(data), "stats reply doesn't fit");
+            for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++) {
+                put_u32(&data[i * 4], counters[i]);
+            }
+            reply(cmd, PROTO_OK, data, sizeof(counters));
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void remote_poll(const dimmer_t *d) {
+    if (dma_chan < 0) return;
+
+    // Re-arm the channel once 2^32 received bytes used up its count, reception resumes at the same ring position
+    if (!dma_channel_is_busy(dma_chan)) dma_channel_set_trans_count(dma_chan, UINT32_MAX, true);
+
+    const uint32_t write_index = (dma_channel_hw_addr(dma_chan)->write_addr - (uintptr_t)rx_ring) & RX_MASK;
+    received += (write_index - received) & RX_MASK;
+
+    // Bytes of the current frame were overwritten before it ended
+    if (received - frame_start > REMOTE_RX_SIZE) {
+        stats.overruns++;
+        frame_start = scanned = received;
+    }
+
+    for (; scanned != received; scanned++) {
+        if (rx_ring[scanned & RX_MASK] != 0) continue;
+
+        // Delimiter found, decode the frame where it lies in the ring
+        proto_view_t view = { .buf = rx_ring, .mask = RX_MASK, .start = frame_start, .len = scanned - frame_start };
+        frame_start = scanned + 1;
+        if (view.len == 0) continue; // Back-to-back delimiters
+        if (view.len > MAX_ENCODED) {
+            stats.frames_bad++;
+            continue;
+        }
+
+        proto_cmd_t cmd;
+        proto_status status;
+        if (!proto_decode(&view, &cmd, &status)) {
+            stats.frames_bad++;
+            continue;
+        }
+        stats.frames_ok++;
+        if (status != PROTO_OK) reply(&cmd, status, NULL, 0);
+        else execute(&cmd, d);
+    }
+}
+
+const remote_stats_t *remote_get_stats(void) {
+    return &stats;
+}
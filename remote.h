@@ -0,0 +1,25 @@
+#ifndef REMOTE_H
+#define REMOTE_H
+
+// Remote control over the stdio UART using the protocol in proto.h.
+// Received bytes land in a DMA ring and frames are decoded where they lie.
+// Commands are queued as events, so they are handled exactly like encoder input.
+
+#include "pico/stdlib.h"
+#include "dimmer.h"
+
+#define REMOTE_RX_BITS 8 // RX ring holds 2^REMOTE_RX_BITS bytes, DMA wraps on this boundary
+#define REMOTE_RX_SIZE (1u << REMOTE_RX_BITS)
+
+// Link counters, also part of the PROTO_STATS reply
+typedef struct {
+    uint32_t frames_ok; // Frames with a valid CRC
+    uint32_t frames_bad; // Malformed frames or CRC errors
+    uint32_t overruns; // Frames lost because the ring wrapped over them
+} remote_stats_t;
+
+void ini_remote(void); // Start UART RX DMA, call after ini_log()
+void remote_poll(const dimmer_t *d); // Decode received frames and reply
+const remote_stats_t *remote_get_stats(void);
+
+#endif
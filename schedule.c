@@ -0,0 +1,159 @@
+#include "schedule.h"
+#include "evq.h"
+#include "logger.h"
+#include "hardware/timer.h"
+#include "pico/critical_section.h"
+
+#define DAY_US ((uint64_t)SCHEDULE_DAY_S * 1000000)
+
+// Program of the fixture in DIMMER_SCHEDULE builds, times of day in seconds
+static const schedule_entry_t defaults[] = {
+    { 6 * 3600 + 30 * 60, SCHEDULE_RAMP, MAX_BR * 8 / 10, 30 * 60 }, // Sunrise
+    { 7 * 3600, SCHEDULE_CAP, MAX_BR, 0 }, // Day, no cap
+    { 22 * 3600, SCHEDULE_CAP, MAX_BR / 5, 0 }, // Night mode
+    { 23 * 3600 + 30 * 60, SCHEDULE_OFF, 0, 0 } // Lights out
+};
+
+// Heap node: when an entry is next due
+typedef struct {
+    uint64_t due_us; // Timer time
+    uint8_t entry; // Index into entries
+} node_t;
+
+static schedule_entry_t entries[SCHEDULE_SIZE];
+static uint entry_count;
+static node_t heap[SCHEDULE_SIZE]; // heap[0] is due first
+static uint heap_size;
+static bool clock_set;
+static uint64_t midnight_us; // Timer time of the last midnight, wraps if that was before boot
+
+static critical_section_t lock; // The alarm callback pops while the main loop adds
+static int alarm_num = -1;
+static schedule_stats_t stats;
+
+static void swap(const uint a, const uint b) {
+    const node_t t = heap[a];
+    heap[a] = heap[b];
+    heap[b] = t;
+}
+
+static void sift_up(uint i) {
+    while (i > 0 && heap[(i - 1) / 2].due_us > heap[i].due_us) {
+        swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void sift_down(uint i) {
+    while (true) {
+        const uint l = 2 * i + 1;
+        const uint r = l + 1;
+        uint min = i;
+        if (l < heap_size && heap[l].due_us < heap[min].due_us) min = l;
+        if (r < heap_size && heap[r].due_us < heap[min].due_us) min = r;
+        if (min == i) return;
+        swap(i, min);
+        i = min;
+    }
+}
+
+// First time after now the entry's time of day comes round
+static uint64_t next_due(const schedule_entry_t *e, const uint64_t now) {
+    const uint64_t time_of_day = (now - midnight_us) % DAY_US;
+    const uint64_t at = (uint64_t)e->at_s * 1000000;
+    return now + (at > time_of_day ? at - time_of_day : at + DAY_US - time_of_day);
+}
+
+// from_isr picks the logging call for the context, log_isr() takes one producer only
+static void post(const schedule_entry_t *e, const bool from_isr) {
+    event_t event = { .type = EVENT_SET_POWER, .data = 0 };
+    if (e->action == SCHEDULE_ON) event = (event_t){ .type = EVENT_SET_LEVEL, .data = clamp(e->level) };
+    if (e->action == SCHEDULE_RAMP) event = (event_t){ .type = EVENT_FADE, .data = FADE_DATA(clamp(e->level), e->ramp_s * 1000u) };
+    if (e->action == SCHEDULE_CAP) event = (event_t){ .type = EVENT_NIGHT_CAP, .data = clamp(e->level) };
+    stats.fired++;
+    if (!evq_add(&event)) {
+        stats.dropped++;
+        if (from_isr) log_isr("schedule event dropped:", e->action);
+        else log_printf("schedule event dropped: %d\n", e->action);
+    }
+}
+
+// Queue every entry that is due and arm the alarm for the next one. Runs in
+// the alarm callback and after the main loop changes the heap.
+static void dispatch(const bool from_isr) {
+    while (true) {
+        uint8_t due[SCHEDULE_SIZE];
+        uint n = 0;
+        bool missed = false;
+
+        critical_section_enter_blocking(&lock);
+        const uint64_t now = time_us_64();
+        while (heap_size && heap[0].due_us <= now) {
+            due[n++] = heap[0].entry;
+            heap[0].due_us += DAY_US; // Daily, back in at tomorrow's time
+            sift_down(0);
+        }
+        if (heap_size) missed = hardware_alarm_set_target(alarm_num, from_us_since_boot(heap[0].due_us));
+        critical_section_exit(&lock);
+
+        // Posting takes the queue's lock, so not under ours
+        for (uint i = 0; i < n; i++) post(&entries[due[i]], from_isr);
+        // A target passed while arming isn't armed, go round again
+        if (!missed) return;
+    }
+}
+
+static void alarm_callback(const uint alarm) {
+    dispatch(true);
+}
+
+void ini_schedule(void) {
+    critical_section_init(&lock);
+    alarm_num = hardware_alarm_claim_unused(true);
+    hardware_alarm_set_callback(alarm_num, alarm_callback);
+    if (!DIMMER_SCHEDULE) return;
+    for (uint i = 0; i < sizeof(defaults) / sizeof(defaults[0]); i++) schedule_add(&defaults[i]);
+}
+
+bool schedule_add(const schedule_entry_t *entry) {
+    if (entry->at_s >= SCHEDULE_DAY_S || entry->level > MAX_BR || entry->ramp_s * 1000u > FADE_MAX_MS) return false;
+
+    critical_section_enter_blocking(&lock);
+    const bool full = entry_count == SCHEDULE_SIZE;
+    if (!full) {
+        entries[entry_count] = *entry;
+        if (clock_set) {
+            heap[heap_size] = (node_t){ .due_us = next_due(entry, time_us_64()), .entry = (uint8_t)entry_count };
+            sift_up(heap_size++);
+        }
+        entry_count++;
+    }
+    critical_section_exit(&lock);
+
+    if (!full && clock_set) dispatch(false);
+    return !full;
+}
+
+void schedule_set_clock(const uint32_t day_s) {
+    critical_section_enter_blocking(&lock);
+    const uint64_t now = time_us_64();
+    midnight_us = now - (uint64_t)(day_s % SCHEDULE_DAY_S) * 1000000;
+    clock_set = true;
+    // Every due time moves with the clock, rebuild the heap
+    heap_size = 0;
+    for (uint i = 0; i < entry_count; i++) {
+        heap[heap_size] = (node_t){ .due_us = next_due(&entries[i], now), .entry = (uint8_t)i };
+        sift_up(heap_size++);
+    }
+    critical_section_exit(&lock);
+
+    dispatch(false);
+}
+
+bool schedule_armed(void) {
+    return heap_size != 0;
+}
+
+const schedule_stats_t *schedule_get_stats(void) {
+    return &stats;
+}
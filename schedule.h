@@ -0,0 +1,54 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+// Daily schedule: switch on or off, sunrise ramps and night-mode caps at set
+// times of day. Entries wait in a min-heap ordered by when they are next due,
+// only the top of the heap is armed on a hardware alarm, and the alarm
+// callback queues the entry's event like the GPIO callback queues input. No
+// code runs between entries. Times come from the 64-bit timer plus the time
+// of day set by a controller; nothing is armed until the clock is set.
+//
+// The timer stops in dormant along with the crystal, and without a 32 kHz
+// clock the RTC stops too, so no alarm can end dormant. An armed schedule
+// keeps the board out of dormant instead: lights off, it idles in WFE at
+// POWER_LOW_KHZ. The built-in program is only loaded in DIMMER_SCHEDULE
+// builds, where a board whose clock has been set never goes dormant again.
+// Other builds start with an empty schedule and reach dormant as before.
+
+#include "pico/stdlib.h"
+#include "dimmer.h"
+
+#ifndef DIMMER_SCHEDULE
+#define DIMMER_SCHEDULE 0 // Set by the DIMMER_SCHEDULE CMake option
+#endif
+
+#define SCHEDULE_SIZE 16 // Entries the heap holds
+#define SCHEDULE_DAY_S 86400u
+
+typedef enum {
+    SCHEDULE_ON, // Switch on at level
+    SCHEDULE_OFF, // Switch off, the level is kept
+    SCHEDULE_RAMP, // Fade from the current output to level over ramp_s
+    SCHEDULE_CAP // Brightness can't go above level, MAX_BR lifts the cap
+} schedule_action;
+
+typedef struct {
+    uint32_t at_s; // Seconds after midnight
+    schedule_action action;
+    uint16_t level;
+    uint16_t ramp_s; // SCHEDULE_RAMP only, at most FADE_MAX_MS / 1000
+} schedule_entry_t;
+
+// Schedule counters
+typedef struct {
+    uint32_t fired; // Entries that came due
+    uint32_t dropped; // Their events lost to a full queue
+} schedule_stats_t;
+
+void ini_schedule(void); // Claim the alarm, load the built-in entries in DIMMER_SCHEDULE builds
+bool schedule_add(const schedule_entry_t *entry); // False if the heap is full or the entry invalid
+void schedule_set_clock(uint32_t day_s); // Time of day now, in seconds after midnight
+bool schedule_armed(void); // An entry is waiting on the alarm, the timer must keep running
+const schedule_stats_t *schedule_get_stats(void);
+
+#endif
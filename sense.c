@@ -0,0 +1,115 @@
+#include "sense.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+
+#define RING_SAMPLES (SENSE_RING_SIZE / 2) // 16-bit samples
+#define ADC_CLOCK_HZ 48000000 // clk_adc from pll_usb
+#define ADC_CLKDIV (ADC_CLOCK_HZ / SENSE_SAMPLE_HZ - 1) // A conversion starts every 1 + ADC_CLKDIV clk_adc cycles
+
+_Static_assert((RING_SAMPLES & (RING_SAMPLES - 1)) == 0, "ring average divides by a power of two");
+_Static_assert(ADC_CLKDIV >= 95 && ADC_CLKDIV <= 0xFFFF, "SENSE_SAMPLE_HZ outside the ADC divider's 16-bit integer range");
+
+typedef struct {
+    uint16_t counts;
+    q16_t scale;
+} curve_point_t;
+
+static const curve_point_t ambient_curve[] = AMBIENT_CURVE;
+#define CURVE_POINTS (sizeof(ambient_curve) / sizeof(ambient_curve[0]))
+
+// Latest samples, overwritten by DMA in a loop; the write wrap needs SENSE_RING_SIZE alignment.
+// Round robin starts at the lowest input, so sample i is from input i % SENSE_INPUTS.
+static uint16_t ring[RING_SAMPLES] __attribute__((aligned(SENSE_RING_SIZE)));
+static int dma_chan = -1;
+static int32_t filtered[SENSE_INPUTS]; // IIR state per input, ADC counts in Q16
+static sense_stats_t stats = { .ambient_scale = Q16(1) };
+static derate_t derate = { .factor = Q16(1) };
+
+_Static_assert(RING_SAMPLES % SENSE_INPUTS == 0, "ring must hold whole round robin cycles");
+
+void ini_sense(void) {
+    derate_init(&derate);
+    adc_init();
+    adc_set_temp_sensor_enabled(true);
+    if (DIMMER_AMBIENT) {
+        adc_gpio_init(AMBIENT_PIN);
+        adc_select_input(AMBIENT_INPUT);
+        adc_set_round_robin(1u << AMBIENT_INPUT | 1u << SENSE_TEMP_INPUT);
+    }
+    else {
+        adc_select_input(SENSE_TEMP_INPUT);
+    }
+    // Every conversion goes to the FIFO and raises DREQ, samples stay 12 bits in 16
+    adc_fifo_setup(true, true, 1, false, false);
+    adc_set_clkdiv(ADC_CLKDIV);
+
+    dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config config = dma_channel_get_default_config(dma_chan);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_ring(&config, true, SENSE_RING_BITS); // Back to ring[0] after the last sample
+    channel_config_set_dreq(&config, DREQ_ADC);
+    dma_channel_configure(dma_chan, &config, ring, &adc_hw->fifo, UINT32_MAX, true);
+
+    adc_run(true);
+}
+
+// Scale for a filtered reading, linear between the curve points
+static q16_t curve_scale(const uint32_t counts) {
+    if (counts <= ambient_curve[0].counts) return ambient_curve[0].scale;
+    for (uint i = 1; i < CURVE_POINTS; i++) {
+        const curve_point_t *a = &ambient_curve[i - 1];
+        const curve_point_t *b = &ambient_curve[i];
+        if (counts > b->counts) continue;
+        const int32_t span = (int32_t)b->scale - (int32_t)a->scale;
+        // Scales are at most Q16(1) and counts 12 bits, the product fits 31 bits
+        return (q16_t)((int32_t)a->scale + span * (int32_t)(counts - a->counts) / (int32_t)(b->counts - a->counts));
+    }
+    return ambient_curve[CURVE_POINTS - 1].scale;
+}
+
+// Sensor voltage is 0.706 V at 27 C and falls 1.721 mV per degree, 3.3 V reference
+static int32_t temp_mc(const int32_t counts_q16) {
+    const int64_t uv = (int64_t)counts_q16 * 3300000 >> (16 + 12);
+    return 27000 - (int32_t)((uv - 706000) * 1000 / 1721);
+}
+
+void sense_tick(void) {
+    if (dma_chan < 0) return;
+
+    // The sample count lasts about 50 days at 1 kS/s, a fresh one carries on where the ring stopped
+    if (!dma_channel_is_busy(dma_chan)) dma_channel_set_trans_count(dma_chan, UINT32_MAX, true);
+    // Until the ring has filled once part of it still holds zeros
+    else if (!stats.valid && UINT32_MAX - dma_channel_hw_addr(dma_chan)->transfer_count < RING_SAMPLES) return;
+
+    for (uint input = 0; input < SENSE_INPUTS; input++) {
+        // Average of this input's latest samples
+        uint32_t sum = 0;
+        for (uint i = input; i < RING_SAMPLES; i += SENSE_INPUTS) sum += ring[i] & 0xFFF;
+        const int32_t x = (int32_t)(sum * (Q16(1) / (RING_SAMPLES / SENSE_INPUTS))); // At most 4095 in Q16
+
+        // First order IIR low-pass, y += (x - y) / 2^SENSE_IIR_SHIFT
+        if (!stats.valid) filtered[input] = x;
+        filtered[input] += (x - filtered[input]) >> SENSE_IIR_SHIFT;
+    }
+    stats.valid = true;
+
+    if (DIMMER_AMBIENT) {
+        stats.ambient = Q16_ROUND((uint32_t)filtered[0]);
+        stats.ambient_scale = curve_scale(stats.ambient);
+    }
+    stats.temp_mc = temp_mc(filtered[SENSE_INPUTS - 1]);
+    derate_update(&derate, stats.temp_mc);
+}
+q16_t sense_scale(void) {
+    return stats.ambient_scale;
+}
+
+const sense_stats_t *sense_get_stats(void) {
+    return &stats;
+}
+
+const derate_t *sense_get_derate(void) {
+    return &derate;
+}
@@ -0,0 +1,52 @@
+#ifndef SENSE_H
+#define SENSE_H
+
+// Analog inputs. The ADC runs free, in round robin when more than one input
+// is used, and DMA writes every sample into a ring, so sampling costs the CPU
+// nothing. Once per control tick the main loop averages each input's samples
+// in the ring (decimation) and feeds the result through a fixed-point IIR
+// low-pass filter.
+//
+// Ambient light: a photodiode on AMBIENT_PIN scales the user's brightness
+// setpoint along AMBIENT_CURVE, so the fixture backs off in daylight.
+// Temperature: the on-chip sensor (ADC input 4) drives thermal derating, see derate.h.
+
+#include "pico/stdlib.h"
+#include "board.h"
+#include "fixed.h"
+#include "derate.h"
+
+#ifndef DIMMER_AMBIENT
+#define DIMMER_AMBIENT 0 // Set by the DIMMER_AMBIENT CMake option
+#endif
+
+#define SENSE_TEMP_INPUT 4 // ADC input of the on-chip temperature sensor
+#define SENSE_INPUTS (DIMMER_AMBIENT ? 2 : 1) // Inputs in the round robin, ambient first
+// ADC conversions per second across all inputs. Temperature alone would need
+// far fewer, but the 16-bit divider can't pace the ADC below ~732 S/s; the ring average decimates.
+#define SENSE_SAMPLE_HZ 1000
+#define SENSE_RING_BITS 7 // Ring holds 2^SENSE_RING_BITS bytes of 16-bit samples, DMA wraps on this boundary
+#define SENSE_RING_SIZE (1u << SENSE_RING_BITS)
+#define SENSE_IIR_SHIFT 5 // Filter time constant in control ticks, 2^SENSE_IIR_SHIFT
+
+// Setpoint scale against the filtered ambient reading in 12-bit ADC counts,
+// { counts, Q16 scale } with counts rising. Full output in the dark, 30% in daylight.
+#ifndef AMBIENT_CURVE
+#define AMBIENT_CURVE { { 0, Q16(1) }, { 800, Q16(1) }, { 3000, Q16(3) / 10 }, { 4095, Q16(3) / 10 } }
+#endif
+
+// Sensor readings
+typedef struct {
+    bool valid; // The ring has filled once, readings below are filtered samples
+    uint32_t ambient; // Filtered ambient reading, ADC counts
+    q16_t ambient_scale; // Factor applied to the setpoint
+    int32_t temp_mc; // Die temperature, milli-degrees C
+} sense_stats_t;
+
+void ini_sense(void); // Start the ADC and its DMA ring
+void sense_tick(void); // Filter the latest samples, main loop once per control tick
+q16_t sense_scale(void); // Factor for the output level, Q16(1) when no sensor is used
+const sense_stats_t *sense_get_stats(void);
+const derate_t *sense_get_derate(void); // Derate factor for every LED channel and its stats
+
+#endif
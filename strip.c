@@ -0,0 +1,132 @@
+#include "strip.h"
+#include "dimmer.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/pio.h"
+#include "hardware/timer.h"
+#include "ws2812.pio.h"
+
+#if DIMMER_STRIP
+
+#define FRAME_US (1000000 / STRIP_FPS)
+
+static uint32_t pixels[STRIP_PIXELS]; // Full-brightness colours in wire order 0xGGRRBB00
+static uint32_t wire[2][STRIP_PIXELS]; // Scaled frames, the DMA reads one while the other is filled
+static volatile uint front; // Wire buffer sent by the last frame
+static volatile bool ready; // Back buffer holds a frame the alarm hasn't sent yet
+static bool dirty = true; // Pixels changed since the last scaled frame
+static uint32_t scale = 256; // Global brightness, 0..256
+static uint64_t next_frame_us; // Earliest start of the next frame
+
+static PIO pio = pio0;
+static uint sm;
+static int dma_chan = -1;
+static int alarm_num = -1;
+static strip_stats_t stats;
+
+// Both halves of a pixel are scaled with one multiply each: G and B sit 16
+// bits apart, so a product of at most 255 * 256 never carries into the other
+// lane. scale is 0..256, 256 passes the colour through unchanged.
+static void scale_frame(uint32_t *out, const uint32_t *in, const uint32_t s) {
+    for (uint i = 0; i < STRIP_PIXELS; i++) {
+        const uint32_t p = in[i];
+        const uint32_t gb = ((p >> 8) & 0x00FF00FF) * s & 0xFF00FF00;
+        const uint32_t r = ((p & 0x00FF0000) >> 8) * s & 0x00FF0000;
+        out[i] = gb | r;
+    }
+}
+
+// Hardware alarm callback, starts the queued frame
+static void alarm_callback(const uint alarm) {
+    // Cannot happen while the length assert in strip.h holds, try again after the latch
+    if (dma_channel_is_busy(dma_chan)) {
+        stats.late++;
+        hardware_alarm_set_target(alarm, make_timeout_time_us(STRIP_RESET_US));
+        return;
+    }
+    front ^= 1;
+    ready = false;
+    next_frame_us = time_us_64() + FRAME_US;
+    dma_channel_transfer_from_buffer_now(dma_chan, wire[front], STRIP_PIXELS);
+    stats.frames++;
+}
+
+void ini_strip(void) {
+    const uint offset = pio_add_program(pio, &ws2812_program);
+    sm = pio_claim_unused_sm(pio, true);
+    pio_gpio_init(pio, STRIP_PIN);
+    pio_sm_set_consecutive_pindirs(pio, sm, STRIP_PIN, 1, true);
+
+    pio_sm_config config = ws2812_program_get_default_config(offset);
+    sm_config_set_sideset_pins(&config, STRIP_PIN);
+    sm_config_set_out_shift(&config, false, true, 24); // MSB first, autopull the top 24 bits of each word
+    sm_config_set_fifo_join(&config, PIO_FIFO_JOIN_TX);
+    pio_sm_init(pio, sm, offset, &config);
+    strip_set_clkdiv();
+    pio_sm_set_enabled(pio, sm, true);
+
+    dma_chan = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(dma_chan);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(pio, sm, true));
+    dma_channel_configure(dma_chan, &c, &pio->txf[sm], wire[0], 0, false);
+
+    alarm_num = hardware_alarm_claim_unused(true);
+    hardware_alarm_set_callback(alarm_num, alarm_callback);
+}
+
+void strip_set_pixel(const uint index, const uint8_t r, const uint8_t g, const uint8_t b) {
+    if (index >= STRIP_PIXELS) return;
+    pixels[index] = (uint32_t)g << 24 | (uint32_t)r << 16 | (uint32_t)b << 8;
+    dirty = true;
+}
+
+void strip_fill(const uint8_t r, const uint8_t g, const uint8_t b) {
+    for (uint i = 0; i < STRIP_PIXELS; i++) strip_set_pixel(i, r, g, b);
+}
+
+void strip_set_level(const uint32_t level) {
+    const uint32_t s = (clamp(level) * 256 + MAX_BR / 2) / MAX_BR;
+    if (s == scale) return;
+    scale = s;
+    dirty = true;
+}
+
+void strip_poll(void) {
+    // The alarm owns the back buffer until it has sent it
+    if (dma_chan < 0 || !dirty || ready) return;
+
+    scale_frame(wire[front ^ 1], pixels, scale);
+    dirty = false;
+    ready = true;
+    // A target already passed isn't armed, the frame starts right away
+    if (hardware_alarm_set_target(alarm_num, from_us_since_boot(next_frame_us))) alarm_callback(alarm_num);
+}
+
+void strip_set_clkdiv(void) {
+    const uint32_t div256 = (uint32_t)((uint64_t)clock_get_hz(clk_sys) * 256 / (STRIP_BIT_HZ * ws2812_CYCLES_PER_BIT));
+    pio_sm_set_clkdiv_int_frac(pio, sm, div256 >> 8, div256 & 0xFF);
+}
+
+const strip_stats_t *strip_get_stats(void) {
+    return &stats;
+}
+
+#else
+
+// No strip: no buffers, PIO, DMA channel or alarm, every call does nothing
+void ini_strip(void) {}
+void strip_set_pixel(const uint index, const uint8_t r, const uint8_t g, const uint8_t b) {}
+void strip_fill(const uint8_t r, const uint8_t g, const uint8_t b) {}
+void strip_set_level(const uint32_t level) {}
+void strip_poll(void) {}
+void strip_set_clkdiv(void) {}
+
+const strip_stats_t *strip_get_stats(void) {
+    static const strip_stats_t none;
+    return &none;
+}
+
+#endif
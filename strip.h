@@ -0,0 +1,41 @@
+#ifndef STRIP_H
+#define STRIP_H
+
+// WS2812 strip on STRIP_PIN, driven by a PIO state machine fed by DMA. The
+// pixel framebuffer holds full-brightness colours; once per frame the whole
+// buffer is scaled by the global level into one of two wire buffers, two
+// colour channels per multiply, and a hardware alarm starts the DMA at most
+// STRIP_FPS times a second. Input handling never waits on the strip.
+// Without DIMMER_STRIP the calls do nothing and none of the buffers exist.
+
+#include "pico/stdlib.h"
+#include "board.h"
+
+#ifndef DIMMER_STRIP
+#define DIMMER_STRIP 0 // Set by the DIMMER_STRIP CMake option
+#endif
+
+#define STRIP_PIXELS 300 // Pixels on the strip
+#define STRIP_FPS 60 // Highest frame rate
+#define STRIP_BIT_HZ 800000 // WS2812 data rate
+#define STRIP_RESET_US 300 // Low time that latches a frame, newer parts need more than 280 us
+
+// Transfer and latch must fit a frame period, or frames queue up behind each other
+_Static_assert(STRIP_PIXELS * 24 * 1000000ull / STRIP_BIT_HZ + STRIP_RESET_US < 1000000 / STRIP_FPS,
+               "strip is too long for STRIP_FPS");
+
+// Strip counters
+typedef struct {
+    uint32_t frames; // Frames sent
+    uint32_t late; // Alarms that found the previous frame still in flight
+} strip_stats_t;
+
+void ini_strip(void); // Load the PIO program, claim a state machine, DMA channel and alarm
+void strip_set_pixel(uint index, uint8_t r, uint8_t g, uint8_t b); // Colour at full brightness
+void strip_fill(uint8_t r, uint8_t g, uint8_t b); // Same colour on every pixel
+void strip_set_level(uint32_t level); // Global brightness, 0..MAX_BR
+void strip_poll(void); // Scale a changed frame and queue it, main loop each control tick
+void strip_set_clkdiv(void); // Match the PIO divider to the current clk_sys
+const strip_stats_t *strip_get_stats(void);
+
+#endif
@@ -0,0 +1,150 @@
+#include "sync.h"
+#include "power.h"
+#include "hardware/uart.h"
+
+#define SYNC_START 0xA5 // First byte of every frame
+#define FRAME_SIZE 9
+#define TYPE_DELTA 0x01 // value: signed brightness change
+#define TYPE_ABS 0x02 // value: brightness
+#define TYPE_MASK 0x0F
+#define CURVE_SHIFT 4 // Bits 4..6: anim_curve of the transition
+#define FLAG_LIGHTS_ON 0x80
+
+static sync_stats_t stats;
+static sync_post_fn sync_post;
+
+// Leader: state the followers were last told about
+static uint32_t sent_brightness;
+static bool sent_on;
+static bool sent_any;
+static uint8_t tx_seq;
+static uint32_t last_abs_ms;
+static uint32_t fade_end_ms; // When the leader's output reaches the state last sent
+static anim_curve fade_curve;
+
+// Follower: frame being received and the leader state rebuilt from frames
+static uint8_t rx[FRAME_SIZE];
+static uint rx_len;
+static bool rx_synced; // Cleared by a seq gap until the next ABS frame
+static uint8_t rx_seq; // Expected seq of the next frame
+static uint32_t rx_brightness;
+
+// CRC-8, polynomial 0x07
+static uint8_t crc8(const uint8_t *p, const uint len) {
+    uint8_t crc = 0;
+    for (uint i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (int b = 0; b < 8; b++) {
+            crc = crc & 0x80 ? (uint8_t)(crc << 1) ^ 0x07 : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// The divider set by uart_init() is only right for the clk_peri it saw. A
+// leader frame still in the FIFO across the change is garbled; followers drop
+// it on its CRC and the next ABS frame puts them right.
+static void restore_baud(void) {
+    uart_set_baudrate(SYNC_UART, SYNC_BAUD);
+}
+
+void ini_sync(const sync_post_fn post) {
+    if (SYNC_ROLE == SYNC_OFF) return;
+    sync_post = post;
+
+    uart_init(SYNC_UART, SYNC_BAUD);
+    power_add_clock_hook(restore_baud);
+    // Followers stay out of dormant (see main.c), a wake on RX would lose the frame that caused it
+    gpio_set_function(SYNC_ROLE == SYNC_LEADER ? SYNC_TX_PIN : SYNC_RX_PIN, GPIO_FUNC_UART);
+}
+
+static void send_frame(const uint8_t type, const bool on, const uint16_t value, const uint32_t now) {
+    const uint32_t fade = (int32_t)(fade_end_ms - now) > 0 ? fade_end_ms - now : 0;
+    uint8_t frame[FRAME_SIZE] = {
+        SYNC_START, type | fade_curve << CURVE_SHIFT | (on ? FLAG_LIGHTS_ON : 0), tx_seq++, value & 0xFF, value >> 8,
+        fade & 0xFF, (fade >> 8) & 0xFF, fade >> 16, 0
+    };
+    frame[FRAME_SIZE - 1] = crc8(frame, FRAME_SIZE - 1);
+    // Nine bytes always fit the 32-byte TX FIFO at one frame per main loop pass
+    uart_write_blocking(SYNC_UART, frame, FRAME_SIZE);
+    stats.frames_sent++;
+}
+
+static void leader_poll(const dimmer_t *d) {
+    const uint32_t now = to_ms_since_boot(get_absolute_time());
+    const bool changed = !sent_any || d->lights_on != sent_on || d->brightness != sent_brightness;
+    // A new state starts the transition the dimmer chose for it, later frames send what is left of it
+    if (changed) {
+        fade_end_ms = now + d->transition_ms;
+        fade_curve = d->transition_curve;
+    }
+
+    if (!sent_any || d->lights_on != sent_on || now - last_abs_ms >= SYNC_ABS_MS) {
+        send_frame(TYPE_ABS, d->lights_on, d->brightness, now);
+        last_abs_ms = now;
+        sent_any = true;
+    }
+    else if (changed) {
+        send_frame(TYPE_DELTA, d->lights_on, (uint16_t)(int16_t)((int32_t)d->brightness - (int32_t)sent_brightness),
+                   now);
+    }
+    else {
+        return;
+    }
+    sent_brightness = d->brightness;
+    sent_on = d->lights_on;
+}
+
+static void follower_frame(void) {
+    const uint8_t type = rx[1] & TYPE_MASK;
+    const bool on = rx[1] & FLAG_LIGHTS_ON;
+    const uint16_t value = rx[3] | rx[4] << 8;
+    const uint32_t fade = rx[5] | rx[6] << 8 | (uint32_t)rx[7] << 16;
+    const anim_curve curve = (anim_curve)((rx[1] >> CURVE_SHIFT) & 0x07);
+
+    if (type == TYPE_ABS) {
+        rx_brightness = clamp(value);
+        rx_synced = true;
+    }
+    else if (type == TYPE_DELTA && rx_synced && rx[2] == rx_seq) {
+        rx_brightness = clamp((int32_t)rx_brightness + (int16_t)value);
+    }
+    else {
+        // A delta after a lost frame would apply to the wrong base, wait for ABS
+        stats.seq_gaps++;
+        rx_synced = false;
+        return;
+    }
+    rx_seq = rx[2] + 1;
+
+    // The dimmer takes an unknown curve as linear and clamps the fade like a remote one
+    const event_t event = { .type = EVENT_SYNC,
+                            .data = SYNC_DATA(rx_brightness, on, fade > FADE_MAX_MS ? FADE_MAX_MS : fade, curve) };
+    sync_post(&event);
+}
+
+static void follower_poll(void) {
+    while (uart_is_readable(SYNC_UART)) {
+        const uint8_t byte = uart_getc(SYNC_UART);
+        if (rx_len == 0 && byte != SYNC_START) continue; // Hunt for the start of a frame
+        rx[rx_len++] = byte;
+        if (rx_len < FRAME_SIZE) continue;
+
+        rx_len = 0;
+        if (crc8(rx, FRAME_SIZE - 1) != rx[FRAME_SIZE - 1]) {
+            stats.crc_errors++;
+            continue;
+        }
+        stats.frames_received++;
+        follower_frame();
+    }
+}
+
+void sync_poll(const dimmer_t *d) {
+    if (SYNC_ROLE == SYNC_LEADER) leader_poll(d);
+    if (SYNC_ROLE == SYNC_FOLLOWER) follower_poll();
+}
+
+const sync_stats_t *sync_get_stats(void) {
+    return &stats;
+}
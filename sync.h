@@ -0,0 +1,43 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+// Leader/follower brightness sync over a dedicated UART. The leader
+// broadcasts 9-byte frames
+//   [SYNC_START][curve|type|flags][seq][value lo][value hi][fade 3 bytes][crc8]
+// DELTA frames carry the brightness change, ABS frames the full state.
+// ABS frames go out on every on/off change and every SYNC_ABS_MS, so a
+// follower that missed a frame (seq gap) is corrected within that period.
+// Every frame also carries the ms left of the leader's transition and its
+// curve, so followers animate the same fade in step instead of easing over
+// a fixed time.
+
+#include "pico/stdlib.h"
+#include "board.h"
+#include "dimmer.h"
+
+#define SYNC_OFF 0
+#define SYNC_LEADER 1
+#define SYNC_FOLLOWER 2
+#ifndef SYNC_ROLE
+#define SYNC_ROLE SYNC_OFF // Set by the DIMMER_SYNC_ROLE CMake option
+#endif
+
+#define SYNC_UART uart1 // Sync bus on SYNC_TX_PIN/SYNC_RX_PIN, separate from the stdio UART
+#define SYNC_BAUD 115200
+#define SYNC_ABS_MS 1000 // Interval of full state frames for drift correction
+
+// Sync counters
+typedef struct {
+    uint32_t frames_sent; // Leader: frames written to the bus
+    uint32_t frames_received; // Follower: frames with a valid CRC
+    uint32_t crc_errors; // Follower: frames dropped for a bad CRC
+    uint32_t seq_gaps; // Follower: deltas ignored until the next ABS frame
+} sync_stats_t;
+
+typedef bool (*sync_post_fn)(const event_t *event); // Queue an event, false if it was dropped
+
+void ini_sync(sync_post_fn post); // Set up SYNC_UART for the configured role
+void sync_poll(const dimmer_t *d); // Leader: send changes; follower: queue received state
+const sync_stats_t *sync_get_stats(void);
+
+#endif
@@ -0,0 +1,151 @@
+#include <assert.h>
+#include "tasks.h"
+#include "logger.h"
+#include "hardware/sync.h"
+#if DIMMER_FREERTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
+
+static const task_t *table;
+static uint table_size;
+static task_stats_t stats[TASKS_MAX];
+
+static void run(const uint i) {
+    const uint32_t start = time_us_32();
+    table[i].run();
+    const uint32_t us = time_us_32() - start;
+    stats[i].runs++;
+    stats[i].total_us += us;
+    if (us > stats[i].max_us) stats[i].max_us = us;
+}
+
+#if DIMMER_FREERTOS
+
+static TaskHandle_t handles[TASKS_MAX];
+
+static void event_task(void *param) {
+    const uint i = (uint)(uintptr_t)param;
+    while (true) {
+        // A signal given while the task was busy is kept, none is lost before the wait
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (table[i].ready()) run(i);
+    }
+}
+
+static void timer_task(void *param) {
+    const uint i = (uint)(uintptr_t)param;
+    TickType_t last = xTaskGetTickCount();
+    while (true) {
+        vTaskDelayUntil(&last, pdMS_TO_TICKS(table[i].period_ms));
+        run(i);
+    }
+}
+
+void tasks_run(const task_t *tasks, const uint n) {
+    assert(n <= TASKS_MAX);
+    table = tasks;
+    table_size = n;
+
+    for (uint i = 0; i < n; i++) {
+        if (tasks[i].kind == TASK_IDLE) continue;
+        assert(tasks[i].priority < configMAX_PRIORITIES - 1); // The timer daemon stays on top
+        xTaskCreate(tasks[i].kind == TASK_EVENT ? event_task : timer_task, tasks[i].name, TASKS_STACK_WORDS,
+                    (void *)(uintptr_t)i, tskIDLE_PRIORITY + tasks[i].priority, &handles[i]);
+        vTaskCoreAffinitySet(handles[i], 1u << tasks[i].core);
+    }
+    vTaskStartScheduler();
+}
+
+void tasks_signal(void) {
+    BaseType_t woken = pdFALSE;
+    const bool isr = __get_current_exception() != 0;
+    for (uint i = 0; i < table_size; i++) {
+        if (table[i].kind != TASK_EVENT || !handles[i]) continue;
+        if (isr) vTaskNotifyGiveFromISR(handles[i], &woken);
+        else xTaskNotifyGive(handles[i]);
+    }
+    if (isr) portYIELD_FROM_ISR(woken);
+}
+
+void tasks_lock(void) {
+    vTaskSuspendAll();
+}
+
+void tasks_unlock(void) {
+    xTaskResumeAll();
+}
+
+#else
+
+static uint32_t due_ms[TASKS_MAX]; // TASK_TIMER: next run
+
+static bool is_ready(const uint i, const uint32_t now_ms) {
+    if (table[i].kind == TASK_EVENT) return table[i].ready();
+    if (table[i].kind == TASK_TIMER) return (int32_t)(now_ms - due_ms[i]) >= 0;
+    return false;
+}
+
+// Highest priority ready task, -1 if there is none
+static int next_ready(const uint32_t now_ms) {
+    for (uint i = 0; i < table_size; i++) {
+        if (is_ready(i, now_ms)) return (int)i;
+    }
+    return -1;
+}
+
+void tasks_run(const task_t *tasks, const uint n) {
+    assert(n <= TASKS_MAX);
+    table = tasks;
+    table_size = n;
+    const uint32_t start_ms = to_ms_since_boot(get_absolute_time());
+    for (uint i = 0; i < n; i++) due_ms[i] = start_ms + tasks[i].period_ms;
+
+    bool idled = false; // Idle hooks ran since the last wake-up
+    while (true) {
+        const int i = next_ready(to_ms_since_boot(get_absolute_time()));
+        if (i >= 0) {
+            if (table[i].kind == TASK_TIMER) {
+                // Keep the period, but don't run a late task several times to catch up
+                const uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+                due_ms[i] += table[i].period_ms;
+                if ((int32_t)(now_ms - due_ms[i]) >= 0) due_ms[i] = now_ms + table[i].period_ms;
+            }
+            run((uint)i);
+            continue;
+        }
+
+        // Scan once more after the idle hooks, they may have made work: a wake-up from dormant queues the press
+        if (!idled) {
+            for (uint h = 0; h < n; h++) {
+                if (table[h].kind == TASK_IDLE) run(h);
+            }
+            idled = true;
+            continue;
+        }
+        __wfe();
+        idled = false;
+    }
+}
+
+void tasks_signal(void) {
+    // An interrupt wakes WFE by itself, this covers a signal from the other core
+    __sev();
+}
+
+// Tasks never preempt each other here
+void tasks_lock(void) {}
+void tasks_unlock(void) {}
+
+#endif
+
+const task_stats_t *tasks_get_stats(const uint index) {
+    return &stats[index];
+}
+
+void tasks_report(void) {
+    for (uint i = 0; i < table_size; i++) {
+        log_printf("task %s: %u runs, %u us total, %u us max\n", table[i].name, stats[i].runs, stats[i].total_us,
+                   stats[i].max_us);
+    }
+}
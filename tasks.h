@@ -0,0 +1,59 @@
+#ifndef TASKS_H
+#define TASKS_H
+
+// Cooperative run-to-completion scheduler for the main loop. Tasks sit in a
+// table in priority order, highest first. After every task the scan starts
+// again from the top, so a ready input task waits for at most the one task
+// already running, never for a queue of background work. When nothing is
+// ready the idle hooks run and the core waits in WFE for an interrupt. Any
+// interrupt after the last scan sets the event register, so a wake-up can't
+// be lost between the check and the wait.
+//
+// DIMMER_FREERTOS builds run the same table on FreeRTOS SMP instead: each
+// event and timer task becomes a FreeRTOS task on its core and priority,
+// event tasks wait for a notification from tasks_signal(), and idle is the
+// kernel's idle task. Tasks of one priority don't time slice, so they still
+// run to completion against each other. A task above them can preempt them;
+// a lower task that writes state it reads does so between tasks_lock() and
+// tasks_unlock().
+
+#include "pico/stdlib.h"
+
+#ifndef DIMMER_FREERTOS
+#define DIMMER_FREERTOS 0 // Set by the DIMMER_FREERTOS CMake option
+#endif
+
+#define TASKS_MAX 12 // Tasks in one table, run-time counters are kept per entry
+#define TASKS_STACK_WORDS 512 // FreeRTOS builds: stack of each task
+
+typedef enum {
+    TASK_EVENT, // Runs when ready() is true; ready() is only asked if the task would run next
+    TASK_TIMER, // Runs every period_ms; the 1 kHz PWM wrap interrupt wakes the core to check
+    TASK_IDLE // Runs when nothing else is ready, before the core sleeps; not run by FreeRTOS builds
+} task_kind;
+
+typedef struct {
+    const char *name; // For the run-time report
+    task_kind kind;
+    bool (*ready)(void); // TASK_EVENT
+    uint32_t period_ms; // TASK_TIMER
+    void (*run)(void);
+    uint core; // FreeRTOS builds: core the task is pinned to
+    uint priority; // FreeRTOS builds: levels above tskIDLE_PRIORITY, higher preempts lower
+} task_t;
+
+// Run-time counters of one task
+typedef struct {
+    uint32_t runs;
+    uint32_t total_us; // Time spent in run(), wraps after about 71 minutes of run time
+    uint32_t max_us; // Longest single run, the input latency this task can add
+} task_stats_t;
+
+void tasks_run(const task_t *tasks, uint n); // Dispatch forever
+void tasks_signal(void); // Any context: an event task may have become ready
+void tasks_lock(void); // No other task runs on this core until tasks_unlock(); nothing to do in bare-metal builds
+void tasks_unlock(void);
+const task_stats_t *tasks_get_stats(uint index); // Counters of tasks[index]
+void tasks_report(void); // Log the counters of every task
+
+#endif
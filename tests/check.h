@@ -0,0 +1,34 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+// Shared helpers for the host tests. Each test is a plain program that
+// returns nonzero, or aborts in assert(), on the first failure.
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Deterministic xorshift32, a failing run can be replayed from its seed
+static inline uint32_t check_rand(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+// Uniform-enough value in [0, n)
+static inline uint32_t check_below(uint32_t *state, const uint32_t n) {
+    return check_rand(state) % n;
+}
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: %s: ", __FILE__, __LINE__, #cond); \
+        fprintf(stderr, __VA_ARGS__); \
+        fputc('\n', stderr); \
+        return 1; \
+    } \
+} while (0)
+
+#endif
@@ -0,0 +1,89 @@
+#include "check.h"
+#include "derate.h"
+
+// Replays temperature ramps and steps through derate_update() and checks the
+// thresholds and the hysteresis band.
+
+#define STEP_MC 100
+
+// Factor of the plain curve, as derate.h describes it
+static q16_t expected(const int32_t temp_mc) {
+    if (temp_mc <= DERATE_START_MC) return Q16(1);
+    if (temp_mc >= DERATE_FULL_MC) return DERATE_MIN;
+    return Q16(1) - (q16_t)((int64_t)(Q16(1) - DERATE_MIN) * (temp_mc - DERATE_START_MC) /
+                            (DERATE_FULL_MC - DERATE_START_MC));
+}
+
+static int ramps(void) {
+    derate_t dr;
+    derate_init(&dr);
+    CHECK(dr.factor == Q16(1) && !derate_active(&dr), "init");
+
+    // Heating follows the curve at once
+    for (int32_t t = 25000; t <= 95000; t += STEP_MC) {
+        derate_update(&dr, t);
+        CHECK(dr.factor == expected(t), "up %d mC: factor %u, expected %u", t, dr.factor, expected(t));
+        CHECK(derate_active(&dr) == (t > DERATE_START_MC), "up %d mC: active %d", t, derate_active(&dr));
+    }
+    CHECK(dr.factor == DERATE_MIN && dr.entries == 1 && dr.peak_mc == 95000, "top: factor %u entries %u peak %d",
+          dr.factor, dr.entries, dr.peak_mc);
+
+    // Cooling recovers DERATE_HYST_MC late, never above the curve
+    for (int32_t t = 95000; t >= 25000; t -= STEP_MC) {
+        derate_update(&dr, t);
+        CHECK(dr.factor == expected(t + DERATE_HYST_MC), "down %d mC: factor %u, expected %u", t, dr.factor,
+              expected(t + DERATE_HYST_MC));
+        CHECK(dr.factor <= expected(t), "down %d mC: above the curve", t);
+    }
+    CHECK(!derate_active(&dr) && dr.entries == 1 && dr.peak_mc == 95000, "bottom: entries %u", dr.entries);
+
+    // Thresholds on the way down
+    derate_update(&dr, DERATE_FULL_MC);
+    derate_update(&dr, DERATE_FULL_MC - DERATE_HYST_MC);
+    CHECK(dr.factor == DERATE_MIN, "left DERATE_MIN before cooling by DERATE_HYST_MC");
+    derate_update(&dr, DERATE_FULL_MC - DERATE_HYST_MC - STEP_MC);
+    CHECK(dr.factor > DERATE_MIN, "stuck at DERATE_MIN below the band");
+    derate_update(&dr, DERATE_START_MC);
+    CHECK(derate_active(&dr), "recovered at DERATE_START_MC, inside the band");
+    derate_update(&dr, DERATE_START_MC - DERATE_HYST_MC);
+    CHECK(!derate_active(&dr), "still derating at DERATE_START_MC - DERATE_HYST_MC");
+    CHECK(dr.entries == 2, "entries %u", dr.entries);
+    return 0;
+}
+
+static int steps(void) {
+    derate_t dr;
+    derate_init(&dr);
+
+    // A jump lands on the curve, a small drop inside the band changes nothing
+    const int32_t hot = (DERATE_START_MC + DERATE_FULL_MC) / 2;
+    derate_update(&dr, hot);
+    CHECK(dr.factor == expected(hot), "step up: factor %u", dr.factor);
+    derate_update(&dr, hot - DERATE_HYST_MC);
+    CHECK(dr.factor == expected(hot), "step inside the band moved the factor to %u", dr.factor);
+    derate_update(&dr, hot - DERATE_HYST_MC - 2000);
+    CHECK(dr.factor == expected(hot - 2000), "step below the band: factor %u", dr.factor);
+
+    // Straight down to room temperature and back over the threshold
+    derate_update(&dr, 25000);
+    CHECK(!derate_active(&dr), "room temperature still derating");
+    derate_update(&dr, 95000);
+    CHECK(dr.factor == DERATE_MIN && dr.entries == 2, "step to 95 C: factor %u entries %u", dr.factor, dr.entries);
+
+    // Noise around DERATE_START_MC doesn't make the output hunt
+    derate_init(&dr);
+    for (int i = 0; i < 1000; i++) {
+        const q16_t before = dr.factor;
+        derate_update(&dr, DERATE_START_MC + (i & 1 ? -500 : 500));
+        if (i > 0) CHECK(dr.factor <= before, "factor rose from %u to %u at step %d", before, dr.factor, i);
+    }
+    CHECK(dr.entries == 1 && dr.factor == expected(DERATE_START_MC + 500), "noise: entries %u factor %u",
+          dr.entries, dr.factor);
+    return 0;
+}
+
+int main(void) {
+    if (ramps() || steps()) return 1;
+    printf("derate_test: passed\n");
+    return 0;
+}
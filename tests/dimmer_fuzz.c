@@ -0,0 +1,36 @@
+#include <limits.h>
+#include <stdlib.h>
+#include "check.h"
+#include "dimmer_step.h"
+
+// Feeds dimmer_handle_event() random event streams and checks the invariants
+// after every step. Usage: dimmer_fuzz [steps] [seed]
+// dimmer_libfuzzer.c makes the same checks on coverage-guided input.
+
+// Event data biased towards the edges the handlers clamp
+static int32_t random_data(uint32_t *rng) {
+    static const int32_t edges[] = { 0, 1, -1, MAX_BR, MAX_BR + 1, -MAX_BR, INT32_MAX, INT32_MIN,
+                                     FADE_DATA(MAX_BR, FADE_MAX_MS), SYNC_DATA(MAX_BR, 1, FADE_MAX_MS, ANIM_EXP) };
+    if (check_below(rng, 4) == 0) return edges[check_below(rng, sizeof(edges) / sizeof(edges[0]))];
+    if (check_below(rng, 2) == 0) return (int32_t)check_below(rng, 2 * MAX_BR) - MAX_BR;
+    return (int32_t)check_rand(rng);
+}
+
+int main(int argc, char **argv) {
+    const unsigned long steps = argc > 1 ? strtoul(argv[1], NULL, 0) : 100000;
+    uint32_t rng = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 0) : 0x2545F491;
+    if (rng == 0) rng = 1;
+    const uint32_t seed = rng;
+
+    dimmer_t d;
+    dimmer_init(&d);
+    CHECK(dimmer_invariants_hold(&d), "after init");
+
+    for (unsigned long i = 0; i < steps; i++) {
+        const event_t event = { (event_type)check_below(&rng, EVENT_COUNT), random_data(&rng) };
+        const char *failed = dimmer_step(&d, &event);
+        CHECK(failed == NULL, "seed 0x%08x step %lu event %d data %d: %s", seed, i, event.type, event.data, failed);
+    }
+    printf("dimmer_fuzz: %lu steps, seed 0x%08x\n", steps, seed);
+    return 0;
+}
@@ -0,0 +1,26 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include "dimmer_step.h"
+
+// libFuzzer target for the dimmer state machine. Every 5 input bytes are one
+// event: a type byte taken modulo EVENT_COUNT and 32-bit little-endian data.
+// Run with: dimmer_libfuzzer [corpus dir] [-runs=N]
+
+#define EVENT_BYTES 5
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    dimmer_t d;
+    dimmer_init(&d);
+    for (; size >= EVENT_BYTES; data += EVENT_BYTES, size -= EVENT_BYTES) {
+        const event_t event = {
+            (event_type)(data[0] % EVENT_COUNT),
+            (int32_t)((uint32_t)data[1] | (uint32_t)data[2] << 8 | (uint32_t)data[3] << 16 | (uint32_t)data[4] << 24)
+        };
+        const char *failed = dimmer_step(&d, &event);
+        if (failed) {
+            fprintf(stderr, "event %d data %d: %s\n", event.type, event.data, failed);
+            abort();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef DIMMER_STEP_H
+#define DIMMER_STEP_H
+
+// One event through the dimmer with every check the fuzz drivers make.
+// Returns NULL if they all hold, otherwise what failed.
+
+#include "dimmer.h"
+
+static inline const char *dimmer_step(dimmer_t *d, const event_t *event) {
+    const uint32_t before = dimmer_level(d);
+    const bool changed = dimmer_handle_event(d, event);
+    if (!dimmer_invariants_hold(d)) return "invariants broken";
+    // A level change must always be reported, the main loop only animates on true
+    if (!changed && dimmer_level(d) != before) return "level moved without a change";
+    if (d->transition_ms > FADE_MAX_MS) return "transition longer than FADE_MAX_MS";
+    return NULL;
+}
+
+#endif
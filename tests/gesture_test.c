@@ -0,0 +1,155 @@
+#include "check.h"
+#include "evq.h"
+#include "gesture.h"
+#include "logger.h"
+#include "hardware/timer.h"
+
+// Plays press sequences into the recognizer on a simulated clock and alarm,
+// and checks that each sequence yields exactly one gesture event, which
+// then drives a dimmer.
+
+#define MAX_EVENTS 64
+
+static uint64_t now_us;
+static hardware_alarm_callback_t alarm_fn;
+static bool armed;
+static uint64_t target_us;
+
+static event_t events[MAX_EVENTS];
+static unsigned posted;
+
+absolute_time_t get_absolute_time(void) { return now_us; }
+uint32_t to_ms_since_boot(const absolute_time_t t) { return (uint32_t)(t / 1000); }
+int hardware_alarm_claim_unused(bool required) { return 0; }
+void hardware_alarm_set_callback(uint alarm_num, const hardware_alarm_callback_t callback) { alarm_fn = callback; }
+void hardware_alarm_cancel(uint alarm_num) { armed = false; }
+absolute_time_t make_timeout_time_ms(const uint32_t ms) { return now_us + ms * 1000ull; }
+
+bool hardware_alarm_set_target(uint alarm_num, const absolute_time_t t) {
+    armed = true;
+    target_us = t;
+    return false;
+}
+
+bool evq_add(const event_t *event) {
+    assert(posted < MAX_EVENTS);
+    events[posted++] = *event;
+    return true;
+}
+
+void log_isr(const char *msg, int32_t value) {}
+
+// Let ms pass, firing the alarm when it is due
+static void wait(const uint32_t ms) {
+    now_us += ms * 1000ull;
+    if (armed && now_us >= target_us) {
+        armed = false;
+        alarm_fn(0);
+    }
+}
+
+static void click(void) {
+    gesture_button(true);
+    wait(80);
+    gesture_button(false);
+    wait(100);
+}
+
+static bool is_gesture(const event_type type) {
+    return type == EVENT_CLICK || type == EVENT_DOUBLE_CLICK || type == EVENT_TRIPLE_CLICK ||
+           type == EVENT_LONG_PRESS;
+}
+
+// The one gesture posted since the last call, EVENT_COUNT if there were none or several
+static event_type gesture(void) {
+    event_type found = EVENT_COUNT;
+    unsigned count = 0;
+    for (unsigned i = 0; i < posted; i++) {
+        if (!is_gesture(events[i].type)) continue;
+        found = events[i].type;
+        count++;
+    }
+    posted = 0;
+    return count == 1 ? found : EVENT_COUNT;
+}
+
+static bool gesture_pending(void) {
+    for (unsigned i = 0; i < posted; i++) if (is_gesture(events[i].type)) return true;
+    return false;
+}
+
+// Apply the events posted since the last call to d
+static void apply(dimmer_t *d) {
+    for (unsigned i = 0; i < posted; i++) dimmer_handle_event(d, &events[i]);
+    posted = 0;
+}
+
+int main(void) {
+    ini_gesture();
+
+    // A click is only known once the window for a second press has passed
+    click();
+    CHECK(!gesture_pending(), "click posted inside the double click window");
+    wait(DOUBLE_CLICK_MS);
+    CHECK(gesture() == EVENT_CLICK, "single click");
+
+    click();
+    click();
+    CHECK(!gesture_pending(), "double click posted inside the window for a third press");
+    wait(DOUBLE_CLICK_MS);
+    CHECK(gesture() == EVENT_DOUBLE_CLICK, "double click");
+
+    click();
+    click();
+    gesture_button(true);
+    CHECK(gesture() == EVENT_TRIPLE_CLICK, "triple click");
+    gesture_button(false);
+    wait(2 * DOUBLE_CLICK_MS);
+    CHECK(gesture() == EVENT_COUNT && !armed, "events after a triple click");
+
+    gesture_button(true);
+    wait(LONG_PRESS_MS);
+    gesture_button(false);
+    wait(2 * DOUBLE_CLICK_MS);
+    CHECK(gesture() == EVENT_LONG_PRESS, "long press");
+
+    // Press and turn is not a click
+    gesture_button(true);
+    CHECK(gesture_encoder(1), "turn while pressed not taken");
+    gesture_button(false);
+    wait(2 * DOUBLE_CLICK_MS);
+    CHECK(gesture() == EVENT_COUNT, "press and turn ended in a gesture");
+
+    // A triple click only changes the effect, the brightness and power stay
+    dimmer_t d;
+    dimmer_init(&d);
+    d.lights_on = true;
+    d.brightness = 700;
+    click();
+    click();
+    gesture_button(true);
+    gesture_button(false);
+    wait(2 * DOUBLE_CLICK_MS);
+    apply(&d);
+    CHECK(d.lights_on && d.brightness == 700 && d.effect == 1, "triple click: on %d brightness %u effect %u",
+          d.lights_on, d.brightness, d.effect);
+
+    // A double click from off switches on at the preset without a switch off in between
+    dimmer_init(&d);
+    click();
+    apply(&d);
+    CHECK(d.lights_on, "first press of a double click didn't switch on");
+    click();
+    wait(DOUBLE_CLICK_MS);
+    apply(&d);
+    CHECK(d.lights_on && d.brightness == BR_PRESET, "double click: on %d brightness %u", d.lights_on, d.brightness);
+
+    // A click on lit lights switches them off once the window has passed
+    click();
+    wait(DOUBLE_CLICK_MS);
+    apply(&d);
+    CHECK(!d.lights_on, "click left the lights on");
+
+    printf("gesture_test: passed\n");
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include <string.h>
+#include "check.h"
+#include "net.h"
+
+// Runs the datagram layer over a loopback net_transport_t: datagrams sent by
+// the test are delivered from poll(), the way a UDP stack would, and the
+// events they post are applied to a dimmer.
+
+#define QUEUE_SIZE 8
+#define MAX_EVENTS 300
+
+static uint16_t bound_port;
+static uint8_t queue[QUEUE_SIZE][NET_MAX_DATAGRAM];
+static size_t queue_len[QUEUE_SIZE];
+static unsigned queued;
+
+static event_t events[MAX_EVENTS];
+static unsigned posted;
+static bool refuse; // Make the post function drop events like a full queue
+
+static bool loopback_start(const uint16_t port) {
+    bound_port = port;
+    return true;
+}
+
+static void loopback_poll(void) {
+    for (unsigned i = 0; i < queued; i++) net_handle_datagram(queue[i], queue_len[i]);
+    queued = 0;
+}
+
+static const net_transport_t loopback = { loopback_start, loopback_poll };
+
+static bool post(const event_t *event) {
+    if (refuse || posted >= MAX_EVENTS) return false;
+    events[posted++] = *event;
+    return true;
+}
+
+static void send(const uint8_t *data, const size_t len) {
+    memcpy(queue[queued], data, len);
+    queue_len[queued++] = len;
+}
+
+// Datagram builder
+typedef struct {
+    uint8_t buf[NET_MAX_DATAGRAM];
+    size_t len;
+} datagram_t;
+
+static void begin(datagram_t *dg, const uint8_t seq) {
+    dg->buf[0] = NET_MAGIC & 0xFF;
+    dg->buf[1] = NET_MAGIC >> 8;
+    dg->buf[2] = seq;
+    dg->buf[3] = 0;
+    dg->len = 4;
+}
+
+static void add(datagram_t *dg, const uint8_t channel, const uint8_t op, const uint16_t value) {
+    uint8_t *e = &dg->buf[dg->len];
+    e[0] = channel;
+    e[1] = op;
+    e[2] = value & 0xFF;
+    e[3] = value >> 8;
+    dg->buf[3]++;
+    dg->len += 4;
+}
+
+// Apply everything posted since the last call
+static void apply(dimmer_t *d) {
+    for (unsigned i = 0; i < posted; i++) {
+        dimmer_handle_event(d, &events[i]);
+        assert(dimmer_invariants_hold(d));
+    }
+    posted = 0;
+}
+
+int main(void) {
+    dimmer_t d;
+    dimmer_init(&d);
+    CHECK(ini_net(&loopback, post), "start failed");
+    CHECK(bound_port == NET_PORT, "bound port %u", bound_port);
+
+    // Entries for this board and for all boards apply, others are skipped
+    datagram_t dg;
+    begin(&dg, 1);
+    add(&dg, NET_CHANNEL + 1, NET_OP_LEVEL, 10);
+    add(&dg, NET_CHANNEL, NET_OP_LEVEL, 700);
+    add(&dg, NET_CHANNEL_ALL, NET_OP_POWER, 0);
+    add(&dg, NET_CHANNEL, 0x7F, 1); // Unknown operation
+    add(&dg, NET_CHANNEL, NET_OP_SCENE, NET_SCENES); // No such scene
+    send(dg.buf, dg.len);
+    CHECK(posted == 0, "delivered before poll");
+    net_poll();
+    CHECK(posted == 2, "%u events", posted);
+    CHECK(events[0].type == EVENT_SET_LEVEL && events[0].data == 700, "level entry");
+    CHECK(events[1].type == EVENT_SET_POWER && events[1].data == 0, "power entry");
+    apply(&d);
+    CHECK(!d.lights_on && d.brightness == 700, "on %d brightness %u", d.lights_on, d.brightness);
+
+    // Levels are clamped, scenes fade
+    begin(&dg, 2);
+    add(&dg, NET_CHANNEL, NET_OP_LEVEL, 0xFFFF);
+    add(&dg, NET_CHANNEL, NET_OP_SCENE, 1);
+    send(dg.buf, dg.len);
+    net_poll();
+    CHECK(posted == 2 && events[0].data == MAX_BR, "clamped level %d", events[0].data);
+    CHECK(events[1].type == EVENT_FADE, "scene type %d", events[1].type);
+    apply(&d);
+    CHECK(d.lights_on && d.brightness == MAX_BR / 4 && d.transition_ms == 500, "scene brightness %u over %u ms",
+          d.brightness, d.transition_ms);
+
+    // Malformed datagrams are counted and post nothing
+    const uint32_t bad = net_get_stats()->bad_datagrams;
+    begin(&dg, 3);
+    add(&dg, NET_CHANNEL, NET_OP_LEVEL, 1);
+    send(dg.buf, 3); // Short header
+    send(dg.buf, dg.len - 1); // Count doesn't match the length
+    dg.buf[0] ^= 1;
+    send(dg.buf, dg.len); // Wrong magic
+    net_poll();
+    CHECK(posted == 0, "malformed datagrams posted %u events", posted);
+    CHECK(net_get_stats()->bad_datagrams == bad + 3, "bad datagrams %u", net_get_stats()->bad_datagrams - bad);
+
+    // A full queue loses the entry, the datagram still counts
+    const uint32_t dropped = net_get_stats()->events_dropped;
+    refuse = true;
+    begin(&dg, 4);
+    add(&dg, NET_CHANNEL, NET_OP_POWER, 1);
+    send(dg.buf, dg.len);
+    net_poll();
+    refuse = false;
+    CHECK(net_get_stats()->events_dropped == dropped + 1, "dropped %u", net_get_stats()->events_dropped - dropped);
+
+    // Random bytes behind a valid header never break the dimmer
+    uint32_t rng = 0x9E3779B9;
+    for (unsigned i = 0; i < 20000; i++) {
+        begin(&dg, (uint8_t)i);
+        const unsigned count = check_below(&rng, 256);
+        for (unsigned e = 0; e < count; e++) {
+            add(&dg, (uint8_t)check_below(&rng, 4), (uint8_t)check_below(&rng, 5), (uint16_t)check_rand(&rng));
+        }
+        // Now and then a length that doesn't match
+        send(dg.buf, check_below(&rng, 8) == 0 ? check_below(&rng, dg.len + 1) : dg.len);
+        net_poll();
+        apply(&d);
+    }
+    printf("net_loopback: %u datagrams, %u bad\n", net_get_stats()->datagrams, net_get_stats()->bad_datagrams);
+    return 0;
+}
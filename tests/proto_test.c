@@ -0,0 +1,102 @@
+#include <string.h>
+#include "check.h"
+#include "proto.h"
+
+// Round-trips replies through proto_encode_reply() and proto_decode() the
+// way a controller receives them: split at 0x00 delimiters, in a ring buffer
+// that wraps, and behind log text sharing the UART.
+
+#define RING_SIZE 128 // Power of two, like remote.c's receive ring
+#define RING_MASK (RING_SIZE - 1)
+
+typedef struct {
+    uint8_t cmd, seq, status;
+    uint8_t data[PROTO_MAX_FRAME];
+    size_t len;
+    bool valid; // Frame decoded with a good CRC
+} frame_t;
+
+// Split len bytes at start of the ring into frames, like remote_poll()
+static unsigned split(uint8_t *ring, const uint32_t mask, const uint32_t start, const uint32_t len, frame_t *frames) {
+    unsigned n = 0;
+    uint32_t frame_start = start;
+    for (uint32_t i = start; i != start + len; i++) {
+        if (ring[i & mask] != 0) continue;
+        proto_view_t view = { .buf = ring, .mask = mask, .start = frame_start, .len = i - frame_start };
+        frame_start = i + 1;
+        if (view.len == 0) continue;
+
+        frame_t *f = &frames[n++];
+        proto_cmd_t cmd;
+        proto_status status;
+        f->valid = proto_decode(&view, &cmd, &status);
+        if (!f->valid) continue;
+        // Replies aren't commands, the fields are read from the decoded bytes
+        f->cmd = ring[view.start & mask];
+        f->seq = ring[(view.start + 1) & mask];
+        f->status = ring[(view.start + 2) & mask];
+        f->len = view.len - 5;
+        for (size_t b = 0; b < f->len; b++) f->data[b] = ring[(view.start + 3 + b) & mask];
+    }
+    return n;
+}
+
+static bool matches(const frame_t *f, const uint8_t cmd, const uint8_t seq, const proto_status status,
+                    const uint8_t *data, const size_t len) {
+    return f->valid && f->cmd == (cmd | PROTO_REPLY) && f->seq == seq && f->status == status && f->len == len &&
+           memcmp(f->data, data, len) == 0;
+}
+
+int main(void) {
+    uint8_t out[PROTO_MAX_REPLY];
+    uint8_t data[PROTO_MAX_FRAME - 5];
+    frame_t frames[8];
+    uint32_t rng = 0xC0B5;
+
+    // Every payload length, zeros included, decodes back in a linear buffer
+    for (size_t len = 0; len <= sizeof(data); len++) {
+        for (size_t i = 0; i < len; i++) data[i] = check_below(&rng, 3) == 0 ? 0 : (uint8_t)check_rand(&rng);
+        const size_t n = proto_encode_reply(PROTO_QUERY, (uint8_t)len, PROTO_OK, data, len, out, sizeof(out));
+        CHECK(n > 0 && n <= PROTO_MAX_REPLY, "length %zu encoded to %zu bytes", len, n);
+        CHECK(out[0] == 0 && out[n - 1] == 0, "length %zu: missing delimiter", len);
+        for (size_t i = 1; i < n - 1; i++) CHECK(out[i] != 0, "length %zu: 0x00 inside the frame at %zu", len, i);
+        CHECK(split(out, UINT32_MAX, 0, (uint32_t)n, frames) == 1, "length %zu: not one frame", len);
+        CHECK(matches(&frames[0], PROTO_QUERY, (uint8_t)len, PROTO_OK, data, len), "length %zu: round trip", len);
+    }
+    CHECK(proto_encode_reply(PROTO_STATS, 0, PROTO_OK, data, sizeof(data) + 1, out, sizeof(out)) == 0,
+          "oversized reply encoded");
+    CHECK(proto_encode_reply(PROTO_QUERY, 0, PROTO_OK, data, 5, out, 12) == 0, "encoded into a short buffer");
+
+    // Frames that wrap the end of the ring, at every start position
+    uint8_t ring[RING_SIZE];
+    for (size_t i = 0; i < 5; i++) data[i] = (uint8_t)(i * 0x40); // A zero in the payload
+    const size_t n = proto_encode_reply(PROTO_QUERY, 7, PROTO_OK, data, 5, out, sizeof(out));
+    for (uint32_t start = 0; start < RING_SIZE; start++) {
+        memset(ring, 0x55, sizeof(ring));
+        for (size_t i = 0; i < n; i++) ring[(start + i) & RING_MASK] = out[i];
+        CHECK(split(ring, RING_MASK, start, (uint32_t)n, frames) == 1, "start %u: not one frame", start);
+        CHECK(matches(&frames[0], PROTO_QUERY, 7, PROTO_OK, data, 5), "start %u: wrapped frame", start);
+    }
+
+    // Log text right before a reply is a frame of its own and doesn't spoil the reply
+    static const char text[] = "task input: 12 runs, 340 us total, 41 us max\n";
+    uint8_t stream[sizeof(text) + PROTO_MAX_REPLY];
+    memcpy(stream, text, sizeof(text) - 1);
+    const size_t m = proto_encode_reply(PROTO_SET_LEVEL, 9, PROTO_ERR_BUSY, NULL, 0, out, sizeof(out));
+    memcpy(stream + sizeof(text) - 1, out, m);
+    const unsigned count = split(stream, UINT32_MAX, 0, (uint32_t)(sizeof(text) - 1 + m), frames);
+    CHECK(count == 2 && !frames[0].valid, "text: %u frames", count);
+    CHECK(matches(&frames[1], PROTO_SET_LEVEL, 9, PROTO_ERR_BUSY, NULL, 0), "reply behind text");
+
+    // Corrupted frames fail their CRC
+    for (size_t i = 1; i < n - 1; i++) {
+        memcpy(stream, out, n);
+        proto_encode_reply(PROTO_QUERY, 7, PROTO_OK, data, 5, stream, sizeof(stream));
+        stream[i] ^= 0x01;
+        if (stream[i] == 0) continue; // Would split the frame instead
+        CHECK(split(stream, UINT32_MAX, 0, (uint32_t)n, frames) == 1 && !frames[0].valid, "flip at %zu decoded", i);
+    }
+
+    printf("proto_test: passed\n");
+    return 0;
+}
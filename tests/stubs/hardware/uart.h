@@ -0,0 +1,12 @@
+#ifndef HARDWARE_UART_H
+#define HARDWARE_UART_H
+
+#include "pico/stdlib.h"
+
+uint uart_init(uart_inst_t *uart, uint baudrate);
+uint uart_set_baudrate(uart_inst_t *uart, uint baudrate);
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len);
+bool uart_is_readable(uart_inst_t *uart);
+char uart_getc(uart_inst_t *uart);
+
+#endif
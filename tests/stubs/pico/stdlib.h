@@ -0,0 +1,35 @@
+#ifndef PICO_STDLIB_H
+#define PICO_STDLIB_H
+
+// Just enough of the Pico SDK for the UART and timer users among the host
+// tests. The test provides the functions declared here.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+#define KHZ 1000
+#define MHZ 1000000
+#define PICO_DEFAULT_UART_TX_PIN 0
+#define PICO_DEFAULT_UART_RX_PIN 1
+
+enum gpio_function { GPIO_FUNC_UART = 2 };
+
+typedef struct uart_inst uart_inst_t;
+
+// Each build of a module under test names its own UART instance, so several
+// boards can be linked into one test program
+#ifndef TEST_UART
+#define TEST_UART test_uart
+#endif
+extern uart_inst_t TEST_UART;
+#define uart1 (&TEST_UART)
+
+absolute_time_t get_absolute_time(void);
+uint32_t to_ms_since_boot(absolute_time_t t);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+
+#endif
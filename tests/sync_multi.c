@@ -0,0 +1,228 @@
+#include <string.h>
+#include "check.h"
+#include "power.h"
+#include "sync.h"
+#include "hardware/uart.h"
+
+// One leader and two followers on a simulated bus. sync.c is built once per
+// board with its own role, UART and symbol prefix (see CMakeLists.txt). The
+// bus delivers a byte intact only when both ends run at the same effective
+// baud rate, the rate set with uart_set_baudrate() scaled by how far the
+// board's clk_peri moved since.
+
+#define BOARD_API(board) \
+    void board##_ini_sync(sync_post_fn post); \
+    void board##_sync_poll(const dimmer_t *d); \
+    const sync_stats_t *board##_sync_get_stats(void);
+BOARD_API(leader)
+BOARD_API(follower_a)
+BOARD_API(follower_b)
+
+#define CLK_RUN 125000000u
+#define CLK_LOW 48000000u
+#define RX_SIZE 4096
+#define POLL_MS 10 // link_task period
+
+struct uart_inst {
+    uint baud; // Rate asked for
+    uint32_t set_clk; // clk_peri when it was asked for
+    uint32_t clk; // clk_peri now
+    uint8_t rx[RX_SIZE];
+    uint32_t rx_head, rx_tail;
+    uint32_t loss_per_256; // Chance of losing each byte
+};
+
+uart_inst_t leader_uart, follower_a_uart, follower_b_uart;
+static uart_inst_t *const followers[] = { &follower_a_uart, &follower_b_uart };
+
+static uint32_t now_ms;
+static uint32_t rng = 0x1234567;
+static power_clock_fn hooks[3]; // Registered in board init order: leader, a, b
+static uint hook_count;
+
+absolute_time_t get_absolute_time(void) { return now_ms * 1000ull; }
+uint32_t to_ms_since_boot(const absolute_time_t t) { return (uint32_t)(t / 1000); }
+void gpio_set_function(uint gpio, enum gpio_function fn) {}
+
+void power_add_clock_hook(const power_clock_fn fn) {
+    assert(hook_count < 3);
+    hooks[hook_count++] = fn;
+}
+
+uint uart_init(uart_inst_t *uart, const uint baudrate) {
+    return uart_set_baudrate(uart, baudrate);
+}
+
+uint uart_set_baudrate(uart_inst_t *uart, const uint baudrate) {
+    uart->baud = baudrate;
+    uart->set_clk = uart->clk;
+    return baudrate;
+}
+
+static uint64_t effective_baud(const uart_inst_t *uart) {
+    return (uint64_t)uart->baud * uart->clk / uart->set_clk;
+}
+
+void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, const size_t len) {
+    assert(uart == &leader_uart);
+    for (uint f = 0; f < 2; f++) {
+        uart_inst_t *rx = followers[f];
+        for (size_t i = 0; i < len; i++) {
+            if (check_below(&rng, 256) < rx->loss_per_256) continue;
+            // A receiver at another rate samples the wrong bits
+            const uint8_t byte = effective_baud(rx) == effective_baud(uart) ? src[i] : (uint8_t)check_rand(&rng);
+            rx->rx[rx->rx_head++ % RX_SIZE] = byte;
+        }
+    }
+}
+
+bool uart_is_readable(uart_inst_t *uart) { return uart->rx_tail != uart->rx_head; }
+char uart_getc(uart_inst_t *uart) { return (char)uart->rx[uart->rx_tail++ % RX_SIZE]; }
+
+// Followers apply what they receive straight to their own dimmer
+static dimmer_t leader, follower_a, follower_b;
+static anim_t leader_anim, anim_a, anim_b;
+
+// What main.c's input task does with an event: a change starts the output on its transition
+static void apply(dimmer_t *d, anim_t *anim, const event_t *e) {
+    if (dimmer_handle_event(d, e)) {
+        anim_start(anim, 0, Q16(dimmer_level(d)), d->transition_ms, d->transition_curve, now_ms);
+    }
+}
+
+static bool post_a(const event_t *e) { apply(&follower_a, &anim_a, e); return true; }
+static bool post_b(const event_t *e) { apply(&follower_b, &anim_b, e); return true; }
+
+// Change a board's clk_peri the way power_set_sys_khz() does, hooks included
+static void set_clk(uart_inst_t *uart, const uint board, const uint32_t hz, const bool run_hook) {
+    uart->clk = hz;
+    if (run_hook) hooks[board]();
+}
+
+// Run the bus for ms, with random input on the leader if busy
+static void run(const uint32_t ms, const bool busy) {
+    for (uint32_t t = 0; t < ms; t += POLL_MS) {
+        if (busy && check_below(&rng, 4) == 0) {
+            static const event_type types[] = { EVENT_ENCODER, EVENT_ENCODER, EVENT_CLICK, EVENT_SET_LEVEL, EVENT_LONG_PRESS };
+            const event_type type = types[check_below(&rng, sizeof(types) / sizeof(types[0]))];
+            const event_t e = { type, type == EVENT_SET_LEVEL ? (int32_t)check_below(&rng, MAX_BR + 1) :
+                                      type == EVENT_ENCODER ? (check_below(&rng, 2) ? 1 : -1) : 0 };
+            apply(&leader, &leader_anim, &e);
+        }
+        leader_sync_poll(&leader);
+        follower_a_sync_poll(&follower_a);
+        follower_b_sync_poll(&follower_b);
+        anim_tick(&leader_anim, now_ms);
+        anim_tick(&anim_a, now_ms);
+        anim_tick(&anim_b, now_ms);
+        now_ms += POLL_MS;
+    }
+}
+
+// Give the leader an event, then run the boards for ms one control tick at a
+// time and check that every output matches the leader's at every tick
+static int fade(const event_t *e, const uint32_t ms) {
+    apply(&leader, &leader_anim, e);
+    for (uint32_t t = 0; t < ms; t++) {
+        if (now_ms % POLL_MS == 0) {
+            leader_sync_poll(&leader);
+            follower_a_sync_poll(&follower_a);
+            follower_b_sync_poll(&follower_b);
+        }
+        anim_tick(&leader_anim, now_ms);
+        anim_tick(&anim_a, now_ms);
+        anim_tick(&anim_b, now_ms);
+        CHECK(anim_a.value[0] == leader_anim.value[0] && anim_b.value[0] == leader_anim.value[0],
+              "event %d, %u ms in: leader %d a %d b %d", e->type, t, leader_anim.value[0], anim_a.value[0],
+              anim_b.value[0]);
+        now_ms++;
+    }
+    return 0;
+}
+
+static bool in_sync(const dimmer_t *f) {
+    return f->brightness == leader.brightness && f->lights_on == leader.lights_on;
+}
+
+int main(void) {
+    leader_uart.clk = follower_a_uart.clk = follower_b_uart.clk = CLK_RUN;
+    dimmer_init(&leader);
+    dimmer_init(&follower_a);
+    dimmer_init(&follower_b);
+    anim_init(&leader_anim);
+    anim_init(&anim_a);
+    anim_init(&anim_b);
+    leader_ini_sync(NULL);
+    follower_a_ini_sync(post_a);
+    follower_b_ini_sync(post_b);
+    CHECK(hook_count == 3, "%u boards registered a clock hook", hook_count);
+
+    // Clean bus: followers track every change frame by frame
+    uint32_t deltas = 0;
+    for (uint i = 0; i < 2000; i++) {
+        run(POLL_MS, true);
+        CHECK(in_sync(&follower_a) && in_sync(&follower_b), "step %u: leader %u/%d a %u/%d b %u/%d", i,
+              leader.brightness, leader.lights_on, follower_a.brightness, follower_a.lights_on,
+              follower_b.brightness, follower_b.lights_on);
+        deltas = leader_sync_get_stats()->frames_sent;
+    }
+    CHECK(follower_a_sync_get_stats()->frames_received == deltas, "a received %u of %u",
+          follower_a_sync_get_stats()->frames_received, deltas);
+
+    // Lossy link to b only: a stays exact, b recovers within an ABS period once the loss stops
+    follower_b_uart.loss_per_256 = 8;
+    run(20000, true);
+    CHECK(in_sync(&follower_a), "a drifted while b lost bytes");
+    CHECK(follower_b_sync_get_stats()->seq_gaps + follower_b_sync_get_stats()->crc_errors > 0, "no loss seen by b");
+    follower_b_uart.loss_per_256 = 0;
+    run(3 * SYNC_ABS_MS, false);
+    CHECK(in_sync(&follower_b), "b not recovered: leader %u b %u", leader.brightness, follower_b.brightness);
+
+    // Clock changes on either end keep the link when the hooks run
+    const uint32_t crc_a = follower_a_sync_get_stats()->crc_errors;
+    set_clk(&leader_uart, 0, CLK_LOW, true);
+    run(2000, true);
+    set_clk(&follower_a_uart, 1, CLK_LOW, true);
+    set_clk(&follower_b_uart, 2, CLK_LOW, true);
+    set_clk(&leader_uart, 0, CLK_RUN, true);
+    run(2000, true);
+    CHECK(follower_a_sync_get_stats()->crc_errors == crc_a, "%u CRC errors across hooked clock changes",
+          follower_a_sync_get_stats()->crc_errors - crc_a);
+    CHECK(in_sync(&follower_a) && in_sync(&follower_b), "lost sync across hooked clock changes");
+
+    // Without its hook a follower listens at the wrong rate until the baud is set again
+    // Garbage only fails a CRC when it happens to hold a start byte, give it a few hundred frames to do so
+    set_clk(&follower_a_uart, 1, CLK_RUN, false);
+    run(10000, true);
+    CHECK(follower_a_sync_get_stats()->crc_errors > crc_a, "wrong baud rate went unnoticed");
+    hooks[1]();
+    run(3 * SYNC_ABS_MS, false);
+    CHECK(in_sync(&follower_a), "a not recovered after the baud rate was restored");
+
+    // Followers run the leader's transitions, not a fixed ease of their own: from
+    // a link poll on, the outputs match at every tick of a switch, a gesture, a
+    // remote fade and a fade long enough to span ABS frames. The simulated
+    // event lands just before a poll, on the bus followers trail by up to one.
+    static const struct {
+        event_t event;
+        uint32_t ms;
+    } fades[] = {
+        { { EVENT_SET_POWER, 1 }, SWITCH_MS + POLL_MS },
+        { { EVENT_FADE, FADE_DATA(900, 2000) }, 2000 + POLL_MS },
+        { { EVENT_DOUBLE_CLICK, 0 }, GESTURE_MS + POLL_MS },
+        { { EVENT_LONG_PRESS, 0 }, GESTURE_MS / 2 }, // Interrupted halfway
+        { { EVENT_FADE, FADE_DATA(100, 100000) }, 100000 + POLL_MS }, // Above 65535 ms, a multiple of 32
+        { { EVENT_SET_POWER, 0 }, SWITCH_MS + POLL_MS },
+    };
+    run(3 * SYNC_ABS_MS, false);
+    now_ms -= now_ms % POLL_MS;
+    for (uint i = 0; i < sizeof(fades) / sizeof(fades[0]); i++) {
+        if (fade(&fades[i].event, fades[i].ms)) return 1;
+        now_ms += POLL_MS - now_ms % POLL_MS;
+    }
+    CHECK(!anim_busy(&anim_a) && !anim_busy(&anim_b), "followers still fading after the leader stopped");
+
+    printf("sync_multi: %u frames sent, b: %u gaps, %u CRC errors\n", leader_sync_get_stats()->frames_sent,
+           follower_b_sync_get_stats()->seq_gaps, follower_b_sync_get_stats()->crc_errors);
+    return 0;
+}